@@ -0,0 +1,107 @@
+#include "JobSystem.h"
+
+#include <atomic>
+
+namespace App
+{
+JobSystem::JobSystem()
+{
+    const auto threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i < threads - 1; i++)
+        _workers.emplace_back([this]() { WorkerLoop(); });
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock{_mutex};
+        _quit = true;
+    }
+    _condition.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+JobSystem& JobSystem::The()
+{
+    static JobSystem jobSystem{};
+
+    return jobSystem;
+}
+
+void JobSystem::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{_mutex};
+            _condition.wait(lock, [this]() { return _quit || !_jobs.empty(); });
+
+            if (_quit && _jobs.empty())
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+void JobSystem::ParallelFor(int count, const std::function<void(int)>& func)
+{
+    if (count <= 0)
+        return;
+
+    if (count == 1 || _workers.empty())
+    {
+        for (int i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    // Helpers may start after the caller has already finished every index, so the
+    // shared state is reference counted rather than living on this stack frame.
+    struct State
+    {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, &func]() {
+        int finished = 0;
+        for (int i = state->next++; i < count; i = state->next++)
+        {
+            func(i);
+            finished++;
+        }
+
+        if (finished > 0 && (state->done += finished) == count)
+        {
+            std::lock_guard lock{state->mutex};
+            state->condition.notify_all();
+        }
+    };
+
+    const auto helpers = std::min(count - 1, (int)_workers.size());
+    {
+        std::lock_guard lock{_mutex};
+        for (int i = 0; i < helpers; i++)
+        {
+            // func is only touched while indices remain, which the caller waits for below.
+            _jobs.push_back(run);
+        }
+    }
+    _condition.notify_all();
+
+    run();
+
+    std::unique_lock lock{state->mutex};
+    state->condition.wait(lock, [&state, count]() { return state->done == count; });
+}
+} // namespace App
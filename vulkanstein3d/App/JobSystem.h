@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace App
+{
+class JobSystem
+{
+  public:
+    static JobSystem& The();
+
+    // Runs func(0..count-1) on the workers and the calling thread, returns once every index is done.
+    void ParallelFor(int count, const std::function<void(int)>& func);
+
+    int GetThreadCount() const { return (int)_workers.size() + 1; }
+
+    // Runs func on a worker in the background, for long jobs like loading the next level.
+    template <typename Func>
+    auto Async(Func&& func) -> std::future<decltype(func())>
+    {
+        // std::function needs a copyable job, the task is shared.
+        auto task = std::make_shared<std::packaged_task<decltype(func())()>>(std::forward<Func>(func));
+        auto future = task->get_future();
+
+        if (_workers.empty())
+        {
+            (*task)();
+            return future;
+        }
+
+        {
+            std::lock_guard lock{_mutex};
+            _jobs.push_back([task]() { (*task)(); });
+        }
+        _condition.notify_one();
+
+        return future;
+    }
+
+  private:
+    JobSystem();
+    ~JobSystem();
+
+    void WorkerLoop();
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<std::function<void()>> _jobs;
+    bool _quit{false};
+};
+} // namespace App
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace App
+{
+// Hands the latest value from one producer thread to one consumer thread without locks. The producer fills GetBack and
+// publishes it, the consumer picks up the newest published value and reads it through GetFront. Neither side waits,
+// values the consumer didn't get to in time are skipped.
+template <typename T>
+class TripleBuffer
+{
+  public:
+    T& GetBack() { return _slots[_back]; }
+    void Publish()
+    {
+        const auto previous = _middle.exchange(_back | FreshBit, std::memory_order_acq_rel);
+        _back = previous & IndexMask;
+    }
+
+    // True when a newer value was published since the last call, GetFront keeps the old one otherwise.
+    bool Acquire()
+    {
+        if (!(_middle.load(std::memory_order_relaxed) & FreshBit))
+            return false;
+
+        const auto previous = _middle.exchange(_front, std::memory_order_acq_rel);
+        _front = previous & IndexMask;
+        return true;
+    }
+    const T& GetFront() const { return _slots[_front]; }
+
+  private:
+    static constexpr uint8_t IndexMask = 0x3;
+    static constexpr uint8_t FreshBit = 0x4;
+
+    std::array<T, 3> _slots{};
+    uint8_t _back{0};
+    std::atomic<uint8_t> _middle{1}; // slot index, FreshBit when it holds a value the consumer hasn't taken
+    uint8_t _front{2};
+};
+} // namespace App
\ No newline at end of file
@@ -1,90 +1,258 @@
 #include "../Common.h"
 
 #include "Assets.h"
+#include "BlockCompressor.h"
 #include "MeshGenerator.h"
+#include "TextureCache.h"
+
+#include "../App/JobSystem.h"
 
 #include "../Rendering/Buffer.h"
+#include "../Rendering/Device.h"
 #include "../Rendering/Texture.h"
 
 #include "../Wolf3dLoaders/Loaders.h"
+#include "../Wolf3dLoaders/PaletteExpand.h"
 
 #include "xbrz/xbrz.h"
 
 namespace Game
 {
-std::shared_ptr<Rendering::Buffer> GetScaledTextureArrayData(std::shared_ptr<Rendering::Device> device, Wolf3dLoaders::Bitmap& bitmap, int scaleFactor)
+// Rows per xBRZ job, the scaler re-reads a row above each slice so very thin slices waste work.
+constexpr int ScaleSliceRows = 16;
+// Rows of 4x4 blocks per BC1 job.
+constexpr int CompressSliceBlockRows = 16;
+
+// Scales every layer into dst, split into row slices across the job system. Layers are layerStride texels apart.
+void ScaleLayers(const std::vector<const uint32_t*>& layers, uint32_t* dst, size_t layerStride, int width, int height, int scaleFactor)
 {
-    size_t textureSize = bitmap.width * bitmap.height * 4;
-    size_t scaledTextureSize = (scaleFactor * bitmap.width) * (scaleFactor * bitmap.height) * 4;
+    const int slicesPerLayer = (height + ScaleSliceRows - 1) / ScaleSliceRows;
 
-    auto stagingBuffer = Rendering::Buffer::CreateStagingBuffer(device, nullptr, scaledTextureSize * bitmap.layers);
-    uint8_t* mapped = (uint8_t*)stagingBuffer->Map();
+    App::JobSystem::The().ParallelFor((int)layers.size() * slicesPerLayer, [&](int job) {
+        const int layer = job / slicesPerLayer;
+        const int yFirst = (job % slicesPerLayer) * ScaleSliceRows;
+        const int yLast = std::min(height, yFirst + ScaleSliceRows);
 
-    for (int i = 0; i < bitmap.layers; i++)
+        xbrz::scale(scaleFactor, layers[layer], dst + layer * layerStride, width, height, xbrz::ColorFormat::ARGB_UNBUFFERED, xbrz::ScalerCfg(), yFirst, yLast);
+    });
+}
+
+// Box filters src into the next smaller mip. Colours are weighted by alpha so transparent black
+// around sprites doesn't bleed into their edges.
+void DownsampleMip(const uint32_t* src, int width, int height, uint32_t* dst)
+{
+    const int mipWidth = std::max(width / 2, 1);
+    const int mipHeight = std::max(height / 2, 1);
+
+    for (int y = 0; y < mipHeight; y++)
     {
-        auto srcptr = reinterpret_cast<uint32_t*>(bitmap.data.data() + (i * textureSize));
-        auto dstptr = reinterpret_cast<uint32_t*>(mapped + (i * scaledTextureSize));
-        xbrz::scale(scaleFactor, srcptr, dstptr, bitmap.width, bitmap.height, xbrz::ColorFormat::ARGB_UNBUFFERED);
-    }
+        for (int x = 0; x < mipWidth; x++)
+        {
+            const uint32_t texels[4] = {
+                src[std::min(y * 2, height - 1) * width + std::min(x * 2, width - 1)],
+                src[std::min(y * 2, height - 1) * width + std::min(x * 2 + 1, width - 1)],
+                src[std::min(y * 2 + 1, height - 1) * width + std::min(x * 2, width - 1)],
+                src[std::min(y * 2 + 1, height - 1) * width + std::min(x * 2 + 1, width - 1)]};
+
+            uint32_t alpha = 0;
+            uint32_t weighted[3] = {};
+            uint32_t plain[3] = {};
+            for (auto texel : texels)
+            {
+                const uint32_t a = texel >> 24;
+                alpha += a;
+                for (int c = 0; c < 3; c++)
+                {
+                    const uint32_t channel = (texel >> (c * 8)) & 0xFF;
+                    weighted[c] += channel * a;
+                    plain[c] += channel;
+                }
+            }
+
+            uint32_t result = ((alpha + 2) / 4) << 24;
+            for (int c = 0; c < 3; c++)
+            {
+                const uint32_t channel = alpha > 0 ? (weighted[c] + alpha / 2) / alpha : (plain[c] + 2) / 4;
+                result |= channel << (c * 8);
+            }
 
-    stagingBuffer->UnMap();
-    return stagingBuffer;
+            dst[y * mipWidth + x] = result;
+        }
+    }
 }
 
-std::shared_ptr<Rendering::Texture> GetScaledTexture(std::shared_ptr<Rendering::Device> device, Wolf3dLoaders::Loaders& loaders, const std::vector<int> pictures, int scaleFactor)
+// Upscaled layers come from the texture cache when possible, otherwise they're scaled and stored for the next launch.
+// Every layer carries a full mip chain. Devices with BC support get BC1 layers, with punch-through alpha for transparent textures.
+std::shared_ptr<Rendering::Texture> CreateScaledTexture(std::shared_ptr<Rendering::Device> device, TextureCache& textureCache, const std::vector<const uint32_t*>& layers, int width, int height, int scaleFactor, bool transparent, vk::SamplerAddressMode addressMode)
 {
-    size_t textureSize = 0;
-    size_t scaledTextureSize = 0;
-    std::shared_ptr<Rendering::Buffer> stagingBuffer;
-    uint8_t* mapped = nullptr;
-    uint32_t width = 0;
-    uint32_t height = 0;
+    const int scaledWidth = scaleFactor * width;
+    const int scaledHeight = scaleFactor * height;
+    const auto mipLevels = Rendering::Texture::GetMipLevels(scaledWidth, scaledHeight);
+
+    const bool compress = device->GetEnabledFeatures().textureCompressionBC;
+    auto format = vk::Format::eR8G8B8A8Unorm;
+    if (compress)
+        format = transparent ? vk::Format::eBc1RgbaUnormBlock : vk::Format::eBc1RgbUnormBlock;
 
-    for (int i = 0; i < pictures.size(); i++)
+    struct Mip
     {
-        auto bitmap = loaders.LoadPictureTexture(pictures[i]);
-        if (textureSize == 0)
+        int width;
+        int height;
+        size_t texelOffset; // within the uncompressed layer chain
+        size_t offset;      // within the uploaded layer
+    };
+
+    std::vector<Mip> mips;
+    size_t chainTexels = 0;
+    size_t layerSize = 0;
+    for (uint32_t mip = 0; mip < mipLevels; mip++)
+    {
+        const int mipWidth = std::max(scaledWidth >> mip, 1);
+        const int mipHeight = std::max(scaledHeight >> mip, 1);
+        mips.push_back({mipWidth, mipHeight, chainTexels, layerSize});
+
+        chainTexels += (size_t)mipWidth * mipHeight;
+        layerSize += Rendering::Texture::GetImageSize(format, mipWidth, mipHeight);
+    }
+
+    const auto key = TextureCache::ComputeKey(layers, width, height, scaleFactor, xbrz::ScalerCfg(), (uint32_t)format);
+
+    auto stagingBuffer = textureCache.Load(device, key, layerSize * layers.size());
+    if (!stagingBuffer)
+    {
+        // Chains are built in regular memory, mips read back the previous level and staging memory is often write-combined.
+        std::vector<uint32_t> chains(chainTexels * layers.size());
+        ScaleLayers(layers, chains.data(), chainTexels, width, height, scaleFactor);
+
+        // Each mip depends on the previous one, so layers are the unit of work.
+        App::JobSystem::The().ParallelFor((int)layers.size(), [&](int layer) {
+            auto chain = chains.data() + layer * chainTexels;
+            for (size_t mip = 1; mip < mips.size(); mip++)
+                DownsampleMip(chain + mips[mip - 1].texelOffset, mips[mip - 1].width, mips[mip - 1].height, chain + mips[mip].texelOffset);
+        });
+
+        // The finished layers stay on the CPU side for the cache file.
+        const void* result = chains.data();
+        std::vector<uint8_t> compressed;
+        if (compress)
         {
-            textureSize = bitmap.width * bitmap.height * 4;
-            scaledTextureSize = (scaleFactor * bitmap.width) * (scaleFactor * bitmap.height) * 4;
-            stagingBuffer = Rendering::Buffer::CreateStagingBuffer(device, nullptr, scaledTextureSize * pictures.size());
-            mapped = (uint8_t*)stagingBuffer->Map();
-            width = bitmap.width;
-            height = bitmap.height;
+            compressed.resize(layerSize * layers.size());
+            result = compressed.data();
+
+            // Block row slices of every mip of every layer.
+            struct CompressJob
+            {
+                size_t layer;
+                size_t mip;
+                int blockRowFirst;
+            };
+
+            std::vector<CompressJob> jobs;
+            for (size_t layer = 0; layer < layers.size(); layer++)
+            {
+                for (size_t mip = 0; mip < mips.size(); mip++)
+                {
+                    for (int blockRow = 0; blockRow < (mips[mip].height + 3) / 4; blockRow += CompressSliceBlockRows)
+                        jobs.push_back({layer, mip, blockRow});
+                }
+            }
+
+            App::JobSystem::The().ParallelFor((int)jobs.size(), [&](int index) {
+                const auto& job = jobs[index];
+                const auto& mip = mips[job.mip];
+                CompressBC1(chains.data() + job.layer * chainTexels + mip.texelOffset, mip.width, mip.height, compressed.data() + job.layer * layerSize + mip.offset,
+                            transparent, job.blockRowFirst, job.blockRowFirst + CompressSliceBlockRows);
+            });
         }
-        assert(bitmap.width == width && bitmap.height == height);
 
-        auto srcptr = reinterpret_cast<uint32_t*>(bitmap.data.data());
-        auto dstptr = reinterpret_cast<uint32_t*>(mapped + (i * scaledTextureSize));
-        xbrz::scale(scaleFactor, srcptr, dstptr, bitmap.width, bitmap.height, xbrz::ColorFormat::ARGB_UNBUFFERED);
+        stagingBuffer = Rendering::Buffer::CreateStagingBuffer(device, const_cast<void*>(result), layerSize * layers.size());
+        textureCache.Store(key, result, layerSize * layers.size());
     }
 
-    stagingBuffer->UnMap();
-    return Rendering::Texture::CreateTexture(device, stagingBuffer, scaleFactor * width, scaleFactor * height, pictures.size());
+    return Rendering::Texture::CreateTexture(device, stagingBuffer, scaledWidth, scaledHeight, layers.size(), format, mipLevels, addressMode);
 }
 
-Assets::Assets(std::shared_ptr<Rendering::Device> device, const std::filesystem::path& dataPath)
+std::shared_ptr<Rendering::Texture> GetScaledTextureArray(std::shared_ptr<Rendering::Device> device, TextureCache& textureCache, const Wolf3dLoaders::Bitmap& bitmap, int scaleFactor, bool transparent, vk::SamplerAddressMode addressMode)
+{
+    size_t textureSize = bitmap.width * bitmap.height * 4;
+
+    std::vector<const uint32_t*> layers(bitmap.layers);
+    for (int i = 0; i < bitmap.layers; i++)
+        layers[i] = reinterpret_cast<const uint32_t*>(bitmap.data.data() + (i * textureSize));
+
+    return CreateScaledTexture(device, textureCache, layers, bitmap.width, bitmap.height, scaleFactor, transparent, addressMode);
+}
+
+std::shared_ptr<Rendering::Texture> GetIndexedTextureArray(std::shared_ptr<Rendering::Device> device, const Wolf3dLoaders::Bitmap& bitmap, vk::SamplerAddressMode addressMode)
+{
+    return Rendering::Texture::CreateTexture(device, (void*)bitmap.data.data(), bitmap.width, bitmap.height, bitmap.layers, vk::Format::eR8Uint, addressMode);
+}
+
+// Pictures of one texture array share a size, each picture becomes a layer.
+Wolf3dLoaders::Bitmap LoadPictures(Wolf3dLoaders::Loaders& loaders, const std::vector<int>& pictures, Wolf3dLoaders::PixelFormat format)
+{
+    Wolf3dLoaders::Bitmap pictureArray;
+    for (auto picture : pictures)
+    {
+        auto bitmap = loaders.LoadPictureTexture(picture, format);
+        assert(pictureArray.layers == 0 || (bitmap.width == pictureArray.width && bitmap.height == pictureArray.height));
+
+        pictureArray.width = bitmap.width;
+        pictureArray.height = bitmap.height;
+        pictureArray.format = bitmap.format;
+        pictureArray.layers++;
+        pictureArray.data.insert(pictureArray.data.end(), bitmap.data.begin(), bitmap.data.end());
+    }
+
+    return pictureArray;
+}
+
+std::shared_ptr<Rendering::Buffer> CreatePaletteBuffer(std::shared_ptr<Rendering::Device> device, bool transparent)
+{
+    auto& table = Wolf3dLoaders::GetPaletteTable(transparent);
+
+    auto buffer = Rendering::Buffer::CreateStorageBuffer(device, sizeof(table));
+    buffer->SetData((void*)table.data(), sizeof(table));
+    return buffer;
+}
+
+Assets::Assets(std::shared_ptr<Rendering::Device> device, const std::filesystem::path& dataPath, TextureMode textureMode)
+    : _textureMode(textureMode)
 {
     Wolf3dLoaders::Loaders loaders{dataPath};
+    TextureCache textureCache{"texture_cache"};
 
     int scaleFactor = 4;
 
-    AddTexture("tex_gui_loading", GetScaledTexture(device, loaders, {24, 25}, scaleFactor));
-    AddTexture("tex_gui_intro", GetScaledTexture(device, loaders, {87}, scaleFactor));
-    AddTexture("tex_gui_weapons", GetScaledTexture(device, loaders, {91, 92, 93, 94}, scaleFactor));
-    AddTexture("tex_gui_keys", GetScaledTexture(device, loaders, {95, 96, 97}, scaleFactor));
+    const auto format = _textureMode == TextureMode::Indexed ? Wolf3dLoaders::PixelFormat::Indexed8 : Wolf3dLoaders::PixelFormat::Rgba8;
+    auto createTexture = [&](const Wolf3dLoaders::Bitmap& bitmap, bool transparent = false, vk::SamplerAddressMode addressMode = vk::SamplerAddressMode::eClampToEdge) {
+        if (_textureMode == TextureMode::Indexed)
+            return GetIndexedTextureArray(device, bitmap, addressMode);
+
+        return GetScaledTextureArray(device, textureCache, bitmap, scaleFactor, transparent, addressMode);
+    };
+
+    if (_textureMode == TextureMode::Indexed)
+    {
+        AddBuffer("buf_palette", CreatePaletteBuffer(device, false));
+        AddBuffer("buf_palette_transparent", CreatePaletteBuffer(device, true));
+    }
+
+    AddTexture("tex_gui_loading", createTexture(LoadPictures(loaders, {24, 25}, format)));
+    AddTexture("tex_gui_intro", createTexture(LoadPictures(loaders, {87}, format)));
+    AddTexture("tex_gui_weapons", createTexture(LoadPictures(loaders, {91, 92, 93, 94}, format)));
+    AddTexture("tex_gui_keys", createTexture(LoadPictures(loaders, {95, 96, 97}, format)));
 
     // numbers 45-
     // letters 56-81
     // numbers white 99-
 
-    auto wallBitmap = loaders.LoadWallTextures();
-    auto buffer = GetScaledTextureArrayData(device, wallBitmap, scaleFactor);
-    AddTexture("tex_walls", Rendering::Texture::CreateTexture(device, buffer, scaleFactor * wallBitmap.width, scaleFactor * wallBitmap.height, wallBitmap.layers));
+    auto wallBitmap = loaders.LoadWallTextures(format);
+    // Merged wall faces repeat the texture once per tile.
+    AddTexture("tex_walls", createTexture(wallBitmap, false, vk::SamplerAddressMode::eRepeat));
 
-    auto spriteBitmap = loaders.LoadSpriteTextures();
-    buffer = GetScaledTextureArrayData(device, spriteBitmap, scaleFactor);
-    AddTexture("tex_sprites", Rendering::Texture::CreateTexture(device, buffer, scaleFactor * spriteBitmap.width, scaleFactor * spriteBitmap.height, spriteBitmap.layers));
+    auto spriteBitmap = loaders.LoadSpriteTextures(format);
+    AddTexture("tex_sprites", createTexture(spriteBitmap, true));
 }
 
 Assets::~Assets()
@@ -110,4 +278,14 @@ void Assets::AddMaterial(const std::string& name, std::shared_ptr<Rendering::Mat
 {
     _materials[name] = texture;
 }
+
+std::shared_ptr<Rendering::Buffer> Assets::GetBuffer(const std::string& name)
+{
+    return _buffers[name];
+}
+
+void Assets::AddBuffer(const std::string& name, std::shared_ptr<Rendering::Buffer> buffer)
+{
+    _buffers[name] = buffer;
+}
 } // namespace Game
\ No newline at end of file
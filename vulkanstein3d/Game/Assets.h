@@ -5,6 +5,7 @@
 
 namespace Rendering
 {
+class Buffer;
 class Device;
 class Material;
 class Texture;
@@ -12,10 +13,16 @@ class Texture;
 
 namespace Game
 {
+enum class TextureMode
+{
+    Upscaled, // xBRZ upscaled RGBA8
+    Indexed   // R8 palette indices, resolved with a palette buffer in the shaders
+};
+
 class Assets
 {
   public:
-    Assets(std::shared_ptr<Rendering::Device> device, const std::filesystem::path& dataPath);
+    Assets(std::shared_ptr<Rendering::Device> device, const std::filesystem::path& dataPath, TextureMode textureMode = TextureMode::Upscaled);
     ~Assets();
 
     std::shared_ptr<Rendering::Texture> GetTexture(const std::string& name);
@@ -24,8 +31,15 @@ class Assets
     std::shared_ptr<Rendering::Material> GetMaterial(const std::string& name);
     void AddMaterial(const std::string& name, std::shared_ptr<Rendering::Material> texture);
 
+    std::shared_ptr<Rendering::Buffer> GetBuffer(const std::string& name);
+    void AddBuffer(const std::string& name, std::shared_ptr<Rendering::Buffer> buffer);
+
+    TextureMode GetTextureMode() const { return _textureMode; }
+
   private:
+    TextureMode _textureMode;
     std::map<std::string, std::shared_ptr<Rendering::Texture>> _textures;
     std::map<std::string, std::shared_ptr<Rendering::Material>> _materials;
+    std::map<std::string, std::shared_ptr<Rendering::Buffer>> _buffers;
 };
 } // namespace Game
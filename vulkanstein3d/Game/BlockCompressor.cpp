@@ -0,0 +1,191 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Game
+{
+struct Rgb
+{
+    int r, g, b;
+};
+
+static uint16_t PackRgb565(float r, float g, float b)
+{
+    auto quantize = [](float value, int max) { return std::clamp((int)std::lround(value * max / 255.0f), 0, max); };
+    return (uint16_t)((quantize(r, 31) << 11) | (quantize(g, 63) << 5) | quantize(b, 31));
+}
+
+static Rgb UnpackRgb565(uint16_t color)
+{
+    const int r = (color >> 11) & 31;
+    const int g = (color >> 5) & 63;
+    const int b = color & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+}
+
+static int Distance(const Rgb& a, const Rgb& b)
+{
+    const int dr = a.r - b.r;
+    const int dg = a.g - b.g;
+    const int db = a.b - b.b;
+    return dr * dr + dg * dg + db * db;
+}
+
+// Picks endpoints along the principal axis of the opaque texels, then the nearest palette entry per texel.
+static void CompressBlock(const uint32_t texels[16], bool transparent, uint8_t* dst)
+{
+    float colors[16][3];
+    bool opaque[16];
+    int opaqueCount = 0;
+    float mean[3] = {};
+
+    for (int i = 0; i < 16; i++)
+    {
+        colors[i][0] = (float)(texels[i] & 0xFF);
+        colors[i][1] = (float)((texels[i] >> 8) & 0xFF);
+        colors[i][2] = (float)((texels[i] >> 16) & 0xFF);
+        opaque[i] = !transparent || (texels[i] >> 24) >= 128;
+
+        if (opaque[i])
+        {
+            for (int c = 0; c < 3; c++)
+                mean[c] += colors[i][c];
+            opaqueCount++;
+        }
+    }
+
+    const bool hasTransparent = opaqueCount < 16;
+    if (opaqueCount == 0)
+    {
+        // Three colour mode with every index pointing at transparent black.
+        const uint8_t block[8] = {0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF};
+        std::memcpy(dst, block, sizeof(block));
+        return;
+    }
+
+    for (int c = 0; c < 3; c++)
+        mean[c] /= opaqueCount;
+
+    float covariance[6] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        if (!opaque[i])
+            continue;
+
+        const float r = colors[i][0] - mean[0];
+        const float g = colors[i][1] - mean[1];
+        const float b = colors[i][2] - mean[2];
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // Power iteration for the principal axis.
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++)
+    {
+        const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+        const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+        const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+        const float length = std::max({std::abs(x), std::abs(y), std::abs(z)});
+        if (length < 1e-6f)
+            break;
+
+        axis[0] = x / length;
+        axis[1] = y / length;
+        axis[2] = z / length;
+    }
+
+    float minProjection = 0.0f;
+    float maxProjection = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        if (!opaque[i])
+            continue;
+
+        const float projection = (colors[i][0] - mean[0]) * axis[0] + (colors[i][1] - mean[1]) * axis[1] + (colors[i][2] - mean[2]) * axis[2];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    uint16_t color0 = PackRgb565(mean[0] + axis[0] * maxProjection, mean[1] + axis[1] * maxProjection, mean[2] + axis[2] * maxProjection);
+    uint16_t color1 = PackRgb565(mean[0] + axis[0] * minProjection, mean[1] + axis[1] * minProjection, mean[2] + axis[2] * minProjection);
+
+    // color0 > color1 selects four colour mode, color0 <= color1 three colours plus transparent.
+    if (hasTransparent ? color0 > color1 : color0 < color1)
+        std::swap(color0, color1);
+
+    const auto c0 = UnpackRgb565(color0);
+    const auto c1 = UnpackRgb565(color1);
+
+    Rgb palette[4] = {c0, c1};
+    int paletteSize = 4;
+    if (hasTransparent || color0 == color1)
+    {
+        palette[2] = {(c0.r + c1.r) / 2, (c0.g + c1.g) / 2, (c0.b + c1.b) / 2};
+        paletteSize = 3;
+    }
+    else
+    {
+        palette[2] = {(2 * c0.r + c1.r) / 3, (2 * c0.g + c1.g) / 3, (2 * c0.b + c1.b) / 3};
+        palette[3] = {(c0.r + 2 * c1.r) / 3, (c0.g + 2 * c1.g) / 3, (c0.b + 2 * c1.b) / 3};
+    }
+
+    uint32_t indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        uint32_t index = 3;
+        if (opaque[i])
+        {
+            const Rgb color{(int)colors[i][0], (int)colors[i][1], (int)colors[i][2]};
+
+            int bestDistance = Distance(color, palette[0]);
+            index = 0;
+            for (int p = 1; p < paletteSize; p++)
+            {
+                const int distance = Distance(color, palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    index = p;
+                }
+            }
+        }
+
+        indices |= index << (i * 2);
+    }
+
+    dst[0] = color0 & 0xFF;
+    dst[1] = color0 >> 8;
+    dst[2] = color1 & 0xFF;
+    dst[3] = color1 >> 8;
+    std::memcpy(dst + 4, &indices, sizeof(indices));
+}
+
+void CompressBC1(const uint32_t* src, int width, int height, uint8_t* dst, bool transparent, int blockRowFirst, int blockRowLast)
+{
+    const int blocksWide = (width + 3) / 4;
+    blockRowLast = std::min(blockRowLast, (height + 3) / 4);
+
+    uint32_t texels[16];
+    for (int by = blockRowFirst; by < blockRowLast; by++)
+    {
+        for (int bx = 0; bx < blocksWide; bx++)
+        {
+            for (int y = 0; y < 4; y++)
+            {
+                const int sy = std::min(by * 4 + y, height - 1);
+                for (int x = 0; x < 4; x++)
+                    texels[y * 4 + x] = src[sy * width + std::min(bx * 4 + x, width - 1)];
+            }
+
+            CompressBlock(texels, transparent, dst + ((size_t)by * blocksWide + bx) * 8);
+        }
+    }
+}
+} // namespace Game
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Game
+{
+// Compresses block rows [blockRowFirst, blockRowLast) of an RGBA8 image to BC1, edge texels are repeated to
+// fill partial blocks. Transparent images use the three colour mode for blocks that have texels with alpha
+// below half (punch-through alpha).
+void CompressBC1(const uint32_t* src, int width, int height, uint8_t* dst, bool transparent, int blockRowFirst, int blockRowLast);
+} // namespace Game
@@ -0,0 +1,223 @@
+#include "../Common.h"
+
+#include "CollisionGrid.h"
+
+#include <bit>
+
+namespace Game
+{
+namespace
+{
+float SegmentPointDistance2(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+{
+    const auto ab = b - a;
+    const auto length2 = glm::dot(ab, ab);
+    const auto t = length2 > 0.0f ? glm::clamp(glm::dot(p - a, ab) / length2, 0.0f, 1.0f) : 0.0f;
+    const auto d = a + ab * t - p;
+    return glm::dot(d, d);
+}
+
+float RectPointDistance2(const glm::vec2& min, const glm::vec2& max, const glm::vec2& p)
+{
+    const auto d = glm::max(glm::max(min - p, p - max), glm::vec2{0.0f});
+    return glm::dot(d, d);
+}
+
+bool SegmentRectIntersect(const glm::vec2& a, const glm::vec2& b, const glm::vec2& min, const glm::vec2& max)
+{
+    // Slab test
+    float tMin = 0.0f;
+    float tMax = 1.0f;
+    const auto d = b - a;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (glm::abs(d[axis]) < 1e-6f)
+        {
+            if (a[axis] < min[axis] || a[axis] > max[axis])
+                return false;
+            continue;
+        }
+
+        auto t0 = (min[axis] - a[axis]) / d[axis];
+        auto t1 = (max[axis] - a[axis]) / d[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+
+        tMin = glm::max(tMin, t0);
+        tMax = glm::min(tMax, t1);
+        if (tMin > tMax)
+            return false;
+    }
+    return true;
+}
+
+// Closest distance between a segment and a rectangle is at an endpoint of one of them unless they intersect.
+bool CapsuleRectIntersect(const glm::vec2& a, const glm::vec2& b, float radius, const glm::vec2& min, const glm::vec2& max)
+{
+    if (SegmentRectIntersect(a, b, min, max))
+        return true;
+
+    const auto radius2 = radius * radius;
+    if (RectPointDistance2(min, max, a) <= radius2 || RectPointDistance2(min, max, b) <= radius2)
+        return true;
+
+    const std::array<glm::vec2, 4> corners{min, glm::vec2{max.x, min.y}, max, glm::vec2{min.x, max.y}};
+    for (const auto& corner : corners)
+    {
+        if (SegmentPointDistance2(a, b, corner) <= radius2)
+            return true;
+    }
+    return false;
+}
+} // namespace
+
+CollisionGrid::CollisionGrid(int width, float tileSize)
+    : _width(width), _tileSize(tileSize)
+{
+    assert(width <= MaxWidth);
+}
+
+glm::ivec2 CollisionGrid::GetTile(const glm::vec2& pos) const
+{
+    return glm::ivec2{glm::floor(pos / _tileSize)};
+}
+
+uint32_t CollisionGrid::Get(const glm::ivec2& tile) const
+{
+    if (!IsInside(tile))
+        return ~0u;
+
+    uint32_t flags = 0;
+    for (int plane = 0; plane < FlagCount; plane++)
+    {
+        if (_planes[plane][tile.y] & (1ull << tile.x))
+            flags |= 1u << plane;
+    }
+    return flags;
+}
+
+void CollisionGrid::Set(const glm::ivec2& tile, uint32_t flags)
+{
+    if (!IsInside(tile))
+        return;
+
+    for (int plane = 0; plane < FlagCount; plane++)
+    {
+        auto& row = _planes[plane][tile.y];
+        if (flags & (1u << plane))
+            row |= 1ull << tile.x;
+        else
+            row &= ~(1ull << tile.x);
+    }
+}
+
+bool CollisionGrid::Test(const glm::ivec2& tile, uint32_t flags) const
+{
+    if (!IsInside(tile))
+        return true;
+
+    return (GetRow(tile.y, flags) >> tile.x) & 1;
+}
+
+uint64_t CollisionGrid::ColumnMask(int first, int last) const
+{
+    first = std::max(first, 0);
+    last = std::min(last, _width - 1);
+    if (first > last)
+        return 0;
+
+    const auto count = last - first + 1;
+    return (count == 64 ? ~0ull : (1ull << count) - 1) << first;
+}
+
+uint64_t CollisionGrid::GetRow(int y, uint32_t flags) const
+{
+    uint64_t row = 0;
+    for (int plane = 0; plane < FlagCount; plane++)
+    {
+        if (flags & (1u << plane))
+            row |= _planes[plane][y];
+    }
+    return row;
+}
+
+bool CollisionGrid::GetRowSpan(const glm::vec2& from, const glm::vec2& to, float radius, int y, int& first, int& last) const
+{
+    // Clip the segment to the row's z band, the x range of what is left is what the row can see.
+    const auto bandMin = y * _tileSize - radius;
+    const auto bandMax = (y + 1) * _tileSize + radius;
+
+    auto a = from;
+    auto b = to;
+    if (a.y > b.y)
+        std::swap(a, b);
+    if (b.y < bandMin || a.y > bandMax)
+        return false;
+
+    const auto dz = b.y - a.y;
+    auto x0 = a.x;
+    auto x1 = b.x;
+    if (dz > 0.0f)
+    {
+        x0 = a.x + (b.x - a.x) * (glm::max(bandMin, a.y) - a.y) / dz;
+        x1 = a.x + (b.x - a.x) * (glm::min(bandMax, b.y) - a.y) / dz;
+    }
+    if (x0 > x1)
+        std::swap(x0, x1);
+
+    first = (int)glm::floor((x0 - radius) / _tileSize);
+    last = (int)glm::floor((x1 + radius) / _tileSize);
+    return true;
+}
+
+bool CollisionGrid::SweepCircle(const glm::vec2& from, const glm::vec2& to, float radius, uint32_t flags) const
+{
+    const auto firstRow = (int)glm::floor((glm::min(from.y, to.y) - radius) / _tileSize);
+    const auto lastRow = (int)glm::floor((glm::max(from.y, to.y) + radius) / _tileSize);
+
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        int first, last;
+        if (!GetRowSpan(from, to, radius, y, first, last))
+            continue;
+
+        // Outside the grid is solid, the border walls stop anything before it gets there.
+        if (y < 0 || y >= _width || first < 0 || last >= _width)
+            return true;
+
+        auto candidates = GetRow(y, flags) & ColumnMask(first, last);
+        while (candidates != 0)
+        {
+            const auto x = std::countr_zero(candidates);
+            candidates &= candidates - 1;
+
+            const glm::vec2 min{x * _tileSize, y * _tileSize};
+            if (CapsuleRectIntersect(from, to, radius, min, min + _tileSize))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool CollisionGrid::SegmentBlocked(const glm::vec2& from, const glm::vec2& to, uint32_t flags) const
+{
+    const auto firstRow = (int)glm::floor(glm::min(from.y, to.y) / _tileSize);
+    const auto lastRow = (int)glm::floor(glm::max(from.y, to.y) / _tileSize);
+
+    for (int y = firstRow; y <= lastRow; y++)
+    {
+        int first, last;
+        if (!GetRowSpan(from, to, 0.0f, y, first, last))
+            continue;
+
+        if (y < 0 || y >= _width || first < 0 || last >= _width)
+            return true;
+
+        if (GetRow(y, flags) & ColumnMask(first, last))
+            return true;
+    }
+
+    return false;
+}
+} // namespace Game
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace Game
+{
+constexpr uint32_t TileBlocksMovement = 0x1;
+constexpr uint32_t TileBlocksShooting = 0x2;
+
+// Tile flags stored as bit planes, one 64-bit word per row and flag so a whole row is tested with a single AND.
+// Queries take world positions on the x/z plane. Tiles outside the grid block everything.
+class CollisionGrid
+{
+  public:
+    static constexpr int MaxWidth = 64;
+    static constexpr int FlagCount = 2;
+
+    CollisionGrid() = default;
+    CollisionGrid(int width, float tileSize);
+
+    int GetWidth() const { return _width; }
+    bool IsInside(const glm::ivec2& tile) const { return tile.x >= 0 && tile.y >= 0 && tile.x < _width && tile.y < _width; }
+    glm::ivec2 GetTile(const glm::vec2& pos) const;
+
+    uint32_t Get(const glm::ivec2& tile) const;
+    // Replaces all flags of the tile, ignored outside the grid.
+    void Set(const glm::ivec2& tile, uint32_t flags);
+    // True when the tile has any of the flags.
+    bool Test(const glm::ivec2& tile, uint32_t flags) const;
+
+    // Does a circle moved from 'from' to 'to' touch a tile with any of the flags. Rows are culled with column masks
+    // of the swept bounds, only the tiles left in them get an exact test.
+    bool SweepCircle(const glm::vec2& from, const glm::vec2& to, float radius, uint32_t flags) const;
+    // Does the segment cross a tile with any of the flags, exact from the column masks alone.
+    bool SegmentBlocked(const glm::vec2& from, const glm::vec2& to, uint32_t flags) const;
+
+  private:
+    uint64_t ColumnMask(int first, int last) const;
+    uint64_t GetRow(int y, uint32_t flags) const;
+    // Column range covered by the segment (grown by radius) inside rows [y, y + 1) grown by radius, false if it misses the band.
+    bool GetRowSpan(const glm::vec2& from, const glm::vec2& to, float radius, int y, int& first, int& last) const;
+
+  private:
+    int _width{};
+    float _tileSize{1.0f};
+    std::array<std::array<uint64_t, MaxWidth>, FlagCount> _planes{};
+};
+} // namespace Game
@@ -39,6 +39,11 @@ struct Elevator
     bool isActivated{false};
 };
 
+struct Enemy
+{
+    int health{25};
+};
+
 struct Item
 {
     int type{0};
@@ -55,6 +60,12 @@ struct Player
     int ammo{0};
 };
 
+// Transform position at the start of the last tick, rendering interpolates from it.
+struct PreviousTransform
+{
+    glm::vec3 position;
+};
+
 struct Renderable
 {
     int tileIndex{0};
@@ -9,12 +9,16 @@
 #include "../Rendering/Device.h"
 #include "../Wolf3dLoaders/Loaders.h"
 
+#include <algorithm>
+
 namespace Game
 {
 constexpr float DoorMoveTime = 0.75f;
 constexpr float DoorStayOpenTime = 3.0f;
 constexpr float SecretDoorMoveTime = 2.0f;
 constexpr float WeaponChangeTime = 0.2f;
+constexpr float KnifeRange = 15.0f;
+constexpr float GunRange = 1000.0f;
 
 constexpr int TileElevatorSwitchOff = 41;
 constexpr int TileElevatorSwitchOn = 43;
@@ -26,12 +30,23 @@ glm::ivec2 GetTile(const glm::vec3& worldPos)
 }
 
 Level::Level(Rendering::Renderer& renderer, std::shared_ptr<Wolf3dLoaders::Map> map)
-    : _renderer(renderer), _map(map)
+    : Level(renderer._device, map)
+{
+}
+
+Level::Level(std::shared_ptr<Wolf3dLoaders::Map> map)
+    : Level(std::shared_ptr<Rendering::Device>{}, map)
+{
+}
+
+Level::Level(std::shared_ptr<Rendering::Device> device, std::shared_ptr<Wolf3dLoaders::Map> map)
+    : _mapMesh(device, *map.get()), _map(map)
 {
-    _floorMesh = Game::MeshGenerator::BuildFloorPlaneMesh(renderer._device, map->width);
-    _mapMesh = Game::MeshGenerator::BuildMapMesh(renderer._device, *map.get());
+    if (device)
+        _floorMesh = Game::MeshGenerator::BuildFloorPlaneMesh(device, map->width);
 
-    _tileMap.resize(map->width * map->width);
+    _collisionGrid = CollisionGrid(map->width, 10.0f);
+    _raycaster = Raycaster(map->width, 10.0f);
     for (int i = 0; i < map->tiles[0].size(); i++)
     {
         if (map->tiles[0][i] > 53)
@@ -41,19 +56,64 @@ Level::Level(Rendering::Renderer& renderer, std::shared_ptr<Wolf3dLoaders::Map>
         if (map->tiles[1][i] == 98)
             continue;
 
-        // Elevator
+        // Elevator switches are entities so they can be activated, they still stop shots.
         if (map->tiles[0][i] == 21 && (map->tiles[0][i - 1] >= 90 || map->tiles[0][i + 1] >= 90))
+        {
+            _collisionGrid.Set({i % map->width, i / map->width}, TileBlocksShooting);
             continue;
+        }
 
-        _tileMap[i] = TileBlocksMovement | TileBlocksShooting;
+        _collisionGrid.Set({i % map->width, i / map->width}, TileBlocksMovement | TileBlocksShooting);
     }
 
+    _colliderTiles.resize(map->width * map->width);
+
     CreateEntities();
+    _raycaster.Update(_registry);
 
     auto& playerXform = _registry.get<Game::Transform>(GetPlayerEntity());
     playerXform.position.y = 5.5f;
 }
 
+void Level::SetWallTile(int index, int layer)
+{
+    _collisionGrid.Set({index % _map->width, index / _map->width}, layer >= 0 ? TileBlocksMovement | TileBlocksShooting : 0);
+    _mapMesh.SetWall(index % _map->width, index / _map->width, layer);
+}
+
+void Level::AddCollider(entt::entity entity, int index)
+{
+    _registry.emplace<Collider>(entity);
+    _colliderTiles[index].push_back(entity);
+}
+
+entt::entity Level::GetCollider(const glm::ivec2& tile) const
+{
+    if (tile.x < 0 || tile.y < 0 || tile.x >= _map->width || tile.y >= _map->width)
+        return entt::null;
+
+    const auto& colliders = _colliderTiles[tile.y * _map->width + tile.x];
+    return colliders.empty() ? entt::null : colliders.front();
+}
+
+void Level::MoveCollider(entt::entity entity, const glm::vec3& from, const glm::vec3& to)
+{
+    const auto fromTile = GetTile(from);
+    const auto toTile = GetTile(to);
+    if (fromTile == toTile)
+        return;
+
+    // A pushwall can slide over another one, both keep their entry.
+    if (_collisionGrid.IsInside(fromTile))
+    {
+        auto& colliders = _colliderTiles[fromTile.y * _map->width + fromTile.x];
+        colliders.erase(std::remove(colliders.begin(), colliders.end(), entity), colliders.end());
+    }
+
+    if (_collisionGrid.IsInside(toTile))
+        _colliderTiles[toTile.y * _map->width + toTile.x].push_back(entity);
+}
+
 glm::vec3 Level::IndexToPosition(int index, float height)
 {
     return glm::vec3{index % _map->width * 10.0f + 5.0f, height, index / _map->width * 10.0f + 5.0f};
@@ -175,7 +235,7 @@ void Level::CreateSceneryEntity(int index, int objectId)
     if (std::find(blocksMovement.begin(), blocksMovement.end(), objectId) != blocksMovement.end())
         flags |= Game::TileBlocksMovement;
 
-    _tileMap[index] = flags;
+    _collisionGrid.Set({index % _map->width, index / _map->width}, flags);
 }
 
 void Level::CreateDoorEntity(int index, uint32_t flags)
@@ -192,22 +252,18 @@ void Level::CreateDoorEntity(int index, uint32_t flags)
 
     _registry.emplace<Transform>(entity, IndexToPosition(index, 5.0f), scale);
     _registry.emplace<Door>(entity, flags);
-    _registry.emplace<Collider>(entity);
+    AddCollider(entity, index);
     _registry.emplace<Renderable>(entity, tileId);
 }
 
+// Secret doors are part of the map mesh while they stand still and only become renderables while moving.
 void Level::CreateSecretDoorEntity(int index)
 {
     const auto entity = _registry.create();
 
-    int tileId = _map->tiles[0][index] - 1;
-    tileId *= 2;
-    if (tileId % 2 != 0)
-        tileId++;
     _registry.emplace<Transform>(entity, IndexToPosition(index, 5.0f), glm::vec3{10.0f});
     _registry.emplace<SecretDoor>(entity);
-    _registry.emplace<Collider>(entity);
-    _registry.emplace<Renderable>(entity, tileId);
+    AddCollider(entity, index);
 }
 
 void Level::CreateElevatorEntity(int index)
@@ -218,7 +274,7 @@ void Level::CreateElevatorEntity(int index)
 
     _registry.emplace<Transform>(entity, IndexToPosition(index, 5.0f), glm::vec3{10.0f});
     _registry.emplace<Elevator>(entity, isSecret ? Elevator::Type::SecretLevel : Elevator::Type::Normal);
-    _registry.emplace<Collider>(entity);
+    AddCollider(entity, index);
     _registry.emplace<Renderable>(entity, TileElevatorSwitchOff);
 }
 
@@ -233,6 +289,7 @@ void Level::CreateEnemyEntity(int index, int objectId)
     _registry.emplace<Transform>(entity, IndexToPosition(index, 5.0f), glm::vec3{10.0f});
     _registry.emplace<Sprite>(entity, 50);
     _registry.emplace<SpriteAnimation>(entity, mob.baseIndex, mob.angle);
+    _registry.emplace<Enemy>(entity);
     //_registry.emplace<Collider>(entity);
 }
 
@@ -241,8 +298,13 @@ void Level::Update(double delta)
     auto& playerXform = _registry.get<Game::Transform>(_player);
     auto& playerComponent = _registry.get<Game::Player>(_player);
 
+    auto transformView = _registry.view<Game::Transform>();
+    for (auto [entity, xform] : transformView.each())
+        _registry.emplace_or_replace<Game::PreviousTransform>(entity, xform.position);
+
     UpdateInput(delta);
     UpdateDoors(delta);
+    _raycaster.Update(_registry);
     UpdateWeapon(delta);
     UpdateAnimations(delta);
 
@@ -308,6 +370,13 @@ void Level::Update(double delta)
     _registry.destroy(remove.begin(), remove.end());
 }
 
+glm::vec3 Level::GetPreviousPosition(entt::entity entity)
+{
+    // Entities that haven't seen a tick yet stand still.
+    const auto previous = _registry.try_get<Game::PreviousTransform>(entity);
+    return previous != nullptr ? previous->position : _registry.get<Game::Transform>(entity).position;
+}
+
 void Level::UpdateInput(double delta)
 {
     const float MaxSpeedRun = 55.0f;
@@ -382,29 +451,21 @@ void Level::UpdateInput(double delta)
 
 bool Level::IsCollision(const glm::vec3& pos)
 {
-    const auto tile = GetTile(pos);
+    if (_collisionGrid.SweepCircle({pos.x, pos.z}, {pos.x, pos.z}, 3.0f, Game::TileBlocksMovement))
+        return true;
 
-    const auto& tiles = GetTiles();
+    // Colliders block their whole tile, like walls.
+    const auto tile = GetTile(pos);
     for (int y = tile.y - 1; y < tile.y + 2; y++)
     {
         for (int x = tile.x - 1; x < tile.x + 2; x++)
         {
             glm::vec4 rect{x * 10.0f + 5.0f, y * 10.0f + 5.0f, 10.0f, 10.0f};
-            if ((tiles[y * 64 + x] & Game::TileBlocksMovement) && Game::Intersection::CircleRectIntersect({pos.x, pos.z}, 3.0f, rect))
+            if (GetCollider({x, y}) != entt::null && Game::Intersection::CircleRectIntersect({pos.x, pos.z}, 3.0f, rect))
                 return true;
         }
     }
 
-    auto colliderView = _registry.view<Game::Transform, Game::Collider>();
-    for (auto [entity, xform, collider] : colliderView.each())
-    {
-        const auto colliderTile = GetTile(xform.position);
-
-        glm::vec4 rect{colliderTile.x * 10.0f + 5.0f, colliderTile.y * 10.0f + 5.0f, 10.0f, 10.0f};
-        if (Game::Intersection::CircleRectIntersect({pos.x, pos.z}, 3.0f, rect))
-            return true;
-    }
-
     return false;
 }
 
@@ -417,69 +478,93 @@ void Level::Activate()
     const auto activatePosition = playerXform.position + (fpsCamera.front * 7.5f);
     const auto activateTile = GetTile(activatePosition);
 
-    auto colliderView = _registry.view<Game::Transform, Game::Collider>();
-    for (auto [entity, xform, collider] : colliderView.each())
+    const auto entity = GetCollider(activateTile);
+    if (entity == entt::null)
+        return;
+
+    auto& xform = _registry.get<Game::Transform>(entity);
+    const auto colliderTile = activateTile;
+
+    auto doorComponent = _registry.try_get<Game::Door>(entity);
+    if (doorComponent != nullptr)
     {
-        const auto colliderTile = GetTile(xform.position);
-        if (activateTile == colliderTile)
+        if (doorComponent->state == Door::State::Closed)
         {
-            auto doorComponent = _registry.try_get<Game::Door>(entity);
-            if (doorComponent != nullptr)
+            if (doorComponent->flags & Game::DoorGoldKey && !player.hasGoldKey)
             {
-                if (doorComponent->state == Door::State::Closed)
-                {
-                    if (doorComponent->flags & Game::DoorGoldKey && !player.hasGoldKey)
-                    {
-                        spdlog::info("You need the gold key.");
-                        return;
-                    }
-                    if (doorComponent->flags & Game::DoorSilverKey && !player.hasSilverKey)
-                    {
-                        spdlog::info("You need the silver key.");
-                        return;
-                    }
-
-                    auto vertical = (doorComponent->flags & Game::DoorVertical);
-                    doorComponent->state = Door::State::Opening;
-                    doorComponent->time = DoorMoveTime;
-                    doorComponent->doorClosedPos = xform.position;
-                    doorComponent->doorOpenPos = xform.position + (vertical ? glm::vec3{0.0f, 0.0f, 12.0f} : glm::vec3{12.0f, 0.0f, 0.0f});
-                    return;
-                }
+                spdlog::info("You need the gold key.");
+                return;
             }
-            auto secretDoorComponent = _registry.try_get<Game::SecretDoor>(entity);
-            if (secretDoorComponent != nullptr)
+            if (doorComponent->flags & Game::DoorSilverKey && !player.hasSilverKey)
             {
-                if (secretDoorComponent->state == SecretDoor::State::Closed)
-                {
-                    const auto playerTile = GetTile(playerXform.position);
-
-                    glm::vec3 openOffset;
-                    if (playerTile.x == colliderTile.x)
-                        openOffset = {0.0f, 0.0f, playerTile.y > colliderTile.y ? -20.0f : 20.0f};
-                    else if (playerTile.y == colliderTile.y)
-                        openOffset = {playerTile.x > colliderTile.x ? -20.0f : 20.0f, 0.0f, 0.0f};
-                    else
-                        return;
-
-                    secretDoorComponent->state = SecretDoor::State::Opening;
-                    secretDoorComponent->time = SecretDoorMoveTime;
-                    secretDoorComponent->doorClosedPos = xform.position;
-                    secretDoorComponent->doorOpenPos = xform.position + openOffset;
-                    return;
-                }
+                spdlog::info("You need the silver key.");
+                return;
             }
-            auto elevatorComponent = _registry.try_get<Game::Elevator>(entity);
-            if (elevatorComponent != nullptr)
-            {
-                auto rendeableComponent = _registry.try_get<Game::Renderable>(entity);
-                elevatorComponent->isActivated = !elevatorComponent->isActivated;
-                rendeableComponent->tileIndex = elevatorComponent->isActivated ? TileElevatorSwitchOn : TileElevatorSwitchOff;
 
-                _state = elevatorComponent->type == Elevator::Type::Normal ? LevelState::GoToNextLevel : LevelState::GoToSecretLevel;
-            }
+            auto vertical = (doorComponent->flags & Game::DoorVertical);
+            doorComponent->state = Door::State::Opening;
+            doorComponent->time = DoorMoveTime;
+            doorComponent->doorClosedPos = xform.position;
+            doorComponent->doorOpenPos = xform.position + (vertical ? glm::vec3{0.0f, 0.0f, 12.0f} : glm::vec3{12.0f, 0.0f, 0.0f});
+            return;
+        }
+    }
+    auto secretDoorComponent = _registry.try_get<Game::SecretDoor>(entity);
+    if (secretDoorComponent != nullptr)
+    {
+        if (secretDoorComponent->state == SecretDoor::State::Closed)
+        {
+            const auto playerTile = GetTile(playerXform.position);
+
+            glm::vec3 openOffset;
+            if (playerTile.x == colliderTile.x)
+                openOffset = {0.0f, 0.0f, playerTile.y > colliderTile.y ? -20.0f : 20.0f};
+            else if (playerTile.y == colliderTile.y)
+                openOffset = {playerTile.x > colliderTile.x ? -20.0f : 20.0f, 0.0f, 0.0f};
+            else
+                return;
+
+            secretDoorComponent->state = SecretDoor::State::Opening;
+            secretDoorComponent->time = SecretDoorMoveTime;
+            secretDoorComponent->doorClosedPos = xform.position;
+            secretDoorComponent->doorOpenPos = xform.position + openOffset;
+
+            // Lift the wall out of the map mesh while it moves.
+            _registry.emplace<Renderable>(entity, _mapMesh.GetWall(colliderTile.x, colliderTile.y));
+            SetWallTile(colliderTile.y * _map->width + colliderTile.x, -1);
+            return;
         }
     }
+    auto elevatorComponent = _registry.try_get<Game::Elevator>(entity);
+    if (elevatorComponent != nullptr)
+    {
+        auto rendeableComponent = _registry.try_get<Game::Renderable>(entity);
+        elevatorComponent->isActivated = !elevatorComponent->isActivated;
+        rendeableComponent->tileIndex = elevatorComponent->isActivated ? TileElevatorSwitchOn : TileElevatorSwitchOff;
+
+        _state = elevatorComponent->type == Elevator::Type::Normal ? LevelState::GoToNextLevel : LevelState::GoToSecretLevel;
+    }
+}
+
+const Elevator* Level::GetNearbyElevator(float range)
+{
+    const auto& playerXform = _registry.get<Game::Transform>(_player);
+
+    const Elevator* nearest = nullptr;
+    float nearestDistance = range;
+
+    auto view = _registry.view<Game::Transform, Game::Elevator>();
+    for (auto [entity, xform, elevator] : view.each())
+    {
+        const float distance = glm::distance(glm::vec2{xform.position.x, xform.position.z}, glm::vec2{playerXform.position.x, playerXform.position.z});
+        if (distance <= nearestDistance)
+        {
+            nearest = &elevator;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearest;
 }
 
 void Level::UpdateDoors(double delta)
@@ -487,6 +572,7 @@ void Level::UpdateDoors(double delta)
     auto doorView = _registry.view<Game::Transform, Game::Door>();
     for (auto [entity, xform, door] : doorView.each())
     {
+        const auto previousPosition = xform.position;
         door.time -= (float)delta;
 
         switch (door.state)
@@ -527,11 +613,14 @@ void Level::UpdateDoors(double delta)
         default:
             break;
         }
+
+        MoveCollider(entity, previousPosition, xform.position);
     }
 
     auto secretDoorView = _registry.view<Game::Transform, Game::SecretDoor>();
     for (auto [entity, xform, door] : secretDoorView.each())
     {
+        const auto previousPosition = xform.position;
         door.time -= (float)delta;
 
         switch (door.state)
@@ -539,12 +628,22 @@ void Level::UpdateDoors(double delta)
         case SecretDoor::State::Opening: {
             xform.position = glm::mix(door.doorClosedPos, door.doorOpenPos, (SecretDoorMoveTime - door.time) / SecretDoorMoveTime);
             if (door.time <= 0.0f)
+            {
                 door.state = SecretDoor::State::Open;
+
+                // Bake the wall back into the map mesh where it stopped.
+                xform.position = door.doorOpenPos;
+                const auto tile = GetTile(door.doorOpenPos);
+                SetWallTile(tile.y * _map->width + tile.x, _registry.get<Renderable>(entity).tileIndex);
+                _registry.remove<Renderable>(entity);
+            }
             break;
         }
         default:
             break;
         }
+
+        MoveCollider(entity, previousPosition, xform.position);
     }
 }
 
@@ -607,6 +706,7 @@ void Level::UpdateWeapon(double delta)
                     player.ammo--;
 
                 spdlog::info("Ammo: {}", player.ammo);
+                FireWeapon();
             }
         }
 
@@ -659,6 +759,41 @@ void Level::UpdateWeapon(double delta)
     }
 }
 
+void Level::FireWeapon()
+{
+    const auto& playerXform = _registry.get<Game::Transform>(GetPlayerEntity());
+    const auto& fpsCamera = _registry.get<Game::FPSCamera>(GetPlayerEntity());
+
+    const auto hit = Raycast(playerXform.position, fpsCamera.front, _currentWeapon == Weapon::Knife ? KnifeRange : GunRange);
+    if (hit.type != RayHit::Type::Sprite || !_registry.valid(hit.entity))
+        return;
+
+    auto& enemy = _registry.get<Game::Enemy>(hit.entity);
+    enemy.health -= _currentWeapon == Weapon::Knife ? 10 : 15;
+    if (enemy.health <= 0)
+        _registry.destroy(hit.entity);
+}
+
+RayHit Level::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool hitSprites) const
+{
+    const glm::vec2 flat{direction.x, direction.z};
+    if (glm::dot(flat, flat) == 0.0f)
+        return {RayHit::Type::None, maxDistance};
+
+    return _raycaster.Trace(_collisionGrid, {{origin.x, origin.z}, glm::normalize(flat), maxDistance}, hitSprites);
+}
+
+void Level::Raycast(std::span<const Ray> rays, std::span<RayHit> hits, bool hitSprites) const
+{
+    _raycaster.Trace(_collisionGrid, rays, hits, hitSprites);
+}
+
+bool Level::HasLineOfSight(const glm::vec3& from, const glm::vec3& to) const
+{
+    const auto distance = glm::distance(glm::vec2{from.x, from.z}, glm::vec2{to.x, to.z});
+    return Raycast(from, to - from, distance, false).type == RayHit::Type::None;
+}
+
 void Level::UpdateAnimations(double delta)
 {
     auto& playerXform = _registry.get<Game::Transform>(GetPlayerEntity());
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "../Rendering/Renderer.h"
+#include "CollisionGrid.h"
 #include "Components.h"
+#include "MapMesh.h"
 #include "MeshGenerator.h"
+#include "Raycaster.h"
 
 #include "entt/entt.hpp"
 
@@ -19,9 +22,6 @@ struct Map;
 namespace Game
 {
 
-constexpr uint32_t TileBlocksMovement = 0x1;
-constexpr uint32_t TileBlocksShooting = 0x2;
-
 class Level
 {
   public:
@@ -50,18 +50,33 @@ class Level
     };
 
     Level(Rendering::Renderer& renderer, std::shared_ptr<Wolf3dLoaders::Map> map);
+    // Simulation only, without GPU meshes. For tools like the raycast benchmark.
+    explicit Level(std::shared_ptr<Wolf3dLoaders::Map> map);
 
     std::shared_ptr<Wolf3dLoaders::Map> GetMap() { return _map; }
-    const std::vector<uint32_t>& GetTiles() { return _tileMap; }
+    const CollisionGrid& GetCollisionGrid() const { return _collisionGrid; }
+    // Places (layer >= 0) or removes (-1) a solid wall, the map mesh is rebuilt before the next frame.
+    void SetWallTile(int index, int layer);
 
     entt::registry& GetRegistry() { return _registry; }
     entt::entity GetPlayerEntity() { return _player; }
 
+    // Advances the simulation by one tick.
     void Update(double delta);
+    // Position at the start of the last tick, rendering interpolates from it to the current one.
+    glm::vec3 GetPreviousPosition(entt::entity entity);
+
+    // First wall, door or (with hitSprites) enemy along the direction, traced on the x/z plane.
+    RayHit Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, bool hitSprites = true) const;
+    void Raycast(std::span<const Ray> rays, std::span<RayHit> hits, bool hitSprites = true) const;
+    // No wall or closed door part between the points, enemies don't block.
+    bool HasLineOfSight(const glm::vec3& from, const glm::vec3& to) const;
 
     LevelState GetState() { return _state; }
+    // Closest elevator within range of the player, nullptr if there is none.
+    const Elevator* GetNearbyElevator(float range);
 
-    Rendering::Mesh _mapMesh;
+    MapMesh _mapMesh; // re-meshed by the renderer, see MapMesh::Update
     Rendering::Mesh _floorMesh;
 
     Weapon _currentWeapon{Weapon::Pistol};
@@ -69,6 +84,8 @@ class Level
     int _weaponFrameOffset{0};
 
   private:
+    Level(std::shared_ptr<Rendering::Device> device, std::shared_ptr<Wolf3dLoaders::Map> map);
+
     void CreateEntities();
     void CreatePlayerEntity(int index, int objectId);
     void CreateItemEntity(int index);
@@ -80,9 +97,15 @@ class Level
 
     glm::vec3 IndexToPosition(int index, float height = 0.0f);
 
+    void AddCollider(entt::entity entity, int index);
+    // First collider entity on the tile, entt::null when there is none or the tile is outside the map.
+    entt::entity GetCollider(const glm::ivec2& tile) const;
+    void MoveCollider(entt::entity entity, const glm::vec3& from, const glm::vec3& to);
+
     void UpdateInput(double delta);
     void UpdateDoors(double delta);
     void UpdateWeapon(double delta);
+    void FireWeapon();
     void UpdateAnimations(double delta);
 
     bool IsCollision(const glm::vec3& pos);
@@ -91,9 +114,10 @@ class Level
     void ActivateDoor(entt::entity doorEntity);
 
   private:
-    Rendering::Renderer& _renderer;
     std::shared_ptr<Wolf3dLoaders::Map> _map;
-    std::vector<uint32_t> _tileMap;
+    CollisionGrid _collisionGrid;
+    Raycaster _raycaster;
+    std::vector<std::vector<entt::entity>> _colliderTiles; // doors, pushwalls and elevator switches by tile, follows them as they move
 
     entt::registry _registry;
     entt::entity _player{entt::null};
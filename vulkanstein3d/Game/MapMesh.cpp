@@ -0,0 +1,154 @@
+#include "../Common.h"
+
+#include "MapMesh.h"
+#include "MeshGenerator.h"
+
+#include "../Rendering/Buffer.h"
+#include "../Rendering/Renderer.h"
+#include "../Wolf3dLoaders/Loaders.h"
+
+namespace Game
+{
+MapMesh::MapMesh(std::shared_ptr<Rendering::Device> device, const Wolf3dLoaders::Map& map)
+    : _device(device), _walls(MeshGenerator::GetWallLayers(map)), _width(map.width)
+{
+    // Headless levels only keep track of the walls.
+    if (!device)
+        return;
+
+    _chunksPerRow = (_width + ChunkSize - 1) / ChunkSize;
+    _chunks.resize(_chunksPerRow * _chunksPerRow);
+    _dirty.resize(_chunks.size(), true);
+
+    _vertexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eVertexBuffer, _chunks.size() * MaxChunkQuads * 4 * sizeof(PackedVertex));
+    _indexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eIndexBuffer, _chunks.size() * MaxChunkQuads * 6 * sizeof(uint32_t));
+
+    // Nothing reads the buffers yet, the initial build goes through the transfer queue.
+    std::vector<vk::BufferCopy> vertexCopies;
+    std::vector<vk::BufferCopy> indexCopies;
+    if (auto stagingBuffer = BuildDirtyChunks(vertexCopies, indexCopies))
+    {
+        stagingBuffer->UploadTo(_vertexBuffer, vertexCopies);
+        stagingBuffer->UploadTo(_indexBuffer, indexCopies);
+    }
+}
+
+void MapMesh::SetWall(int x, int z, int layer)
+{
+    std::lock_guard lock{_wallsMutex};
+
+    auto& wall = _walls[z * _width + x];
+    if (wall == layer)
+        return;
+
+    wall = (int16_t)layer;
+
+    // Faces of the neighbouring tiles change too, they can live in the next chunk over.
+    const int chunkX = x / ChunkSize;
+    const int chunkZ = z / ChunkSize;
+    MarkDirty(chunkX, chunkZ);
+    if (x % ChunkSize == 0)
+        MarkDirty(chunkX - 1, chunkZ);
+    if (x % ChunkSize == ChunkSize - 1)
+        MarkDirty(chunkX + 1, chunkZ);
+    if (z % ChunkSize == 0)
+        MarkDirty(chunkX, chunkZ - 1);
+    if (z % ChunkSize == ChunkSize - 1)
+        MarkDirty(chunkX, chunkZ + 1);
+}
+
+void MapMesh::Update(Rendering::Renderer& renderer)
+{
+    std::vector<vk::BufferCopy> vertexCopies;
+    std::vector<vk::BufferCopy> indexCopies;
+    std::shared_ptr<Rendering::Buffer> stagingBuffer;
+    {
+        std::lock_guard lock{_wallsMutex};
+        stagingBuffer = BuildDirtyChunks(vertexCopies, indexCopies);
+    }
+
+    if (!stagingBuffer)
+        return;
+
+    renderer.CopyBuffer(stagingBuffer, _vertexBuffer, vertexCopies);
+    renderer.CopyBuffer(stagingBuffer, _indexBuffer, indexCopies);
+}
+
+std::shared_ptr<Rendering::Buffer> MapMesh::BuildDirtyChunks(std::vector<vk::BufferCopy>& vertexCopies, std::vector<vk::BufferCopy>& indexCopies)
+{
+    std::vector<int> chunks;
+    for (int chunk = 0; chunk < (int)_chunks.size(); chunk++)
+    {
+        if (_dirty[chunk])
+            chunks.push_back(chunk);
+    }
+
+    if (chunks.empty())
+        return nullptr;
+
+    // Every dirty chunk goes into one staging buffer, vertices first and indices after them.
+    std::vector<PackedVertex> verts;
+    std::vector<uint32_t> indices;
+    std::vector<std::pair<size_t, size_t>> ranges; // vertex and index count per chunk
+
+    for (auto chunk : chunks)
+    {
+        std::vector<PackedVertex> chunkVerts;
+        std::vector<uint32_t> chunkIndices;
+
+        const glm::ivec2 origin{(chunk % _chunksPerRow) * ChunkSize, (chunk / _chunksPerRow) * ChunkSize};
+        MeshGenerator::BuildWallGeometry(_walls, _width, origin, ChunkSize, chunkVerts, chunkIndices);
+        assert(chunkIndices.size() <= (size_t)MaxChunkQuads * 6);
+
+        ranges.push_back({chunkVerts.size(), chunkIndices.size()});
+        verts.insert(verts.end(), chunkVerts.begin(), chunkVerts.end());
+        indices.insert(indices.end(), chunkIndices.begin(), chunkIndices.end());
+    }
+
+    const size_t vertexBytes = verts.size() * sizeof(PackedVertex);
+    const size_t indexBytes = indices.size() * sizeof(uint32_t);
+
+    size_t vertexOffset = 0;
+    size_t indexOffset = vertexBytes;
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        const int chunk = chunks[i];
+        const auto [vertexCount, indexCount] = ranges[i];
+
+        const uint32_t firstVertex = chunk * MaxChunkQuads * 4;
+        const uint32_t firstIndex = chunk * MaxChunkQuads * 6;
+
+        if (indexCount > 0)
+        {
+            vertexCopies.push_back({vertexOffset, firstVertex * sizeof(PackedVertex), vertexCount * sizeof(PackedVertex)});
+            indexCopies.push_back({indexOffset, firstIndex * sizeof(uint32_t), indexCount * sizeof(uint32_t)});
+        }
+
+        vertexOffset += vertexCount * sizeof(PackedVertex);
+        indexOffset += indexCount * sizeof(uint32_t);
+
+        _chunks[chunk] = {_vertexBuffer, _indexBuffer, (uint32_t)indexCount, firstIndex, (int32_t)firstVertex};
+        _dirty[chunk] = false;
+    }
+
+    if (vertexCopies.empty())
+        return nullptr;
+
+    auto stagingBuffer = Rendering::Buffer::CreateStagingBuffer(_device, nullptr, vertexBytes + indexBytes);
+    auto mapped = (uint8_t*)stagingBuffer->Map();
+    std::memcpy(mapped, verts.data(), vertexBytes);
+    std::memcpy(mapped + vertexBytes, indices.data(), indexBytes);
+    stagingBuffer->UnMap();
+
+    return stagingBuffer;
+}
+
+void MapMesh::MarkDirty(int chunkX, int chunkZ)
+{
+    if (chunkX < 0 || chunkZ < 0 || chunkX >= _chunksPerRow || chunkZ >= _chunksPerRow)
+        return;
+
+    _dirty[chunkZ * _chunksPerRow + chunkX] = true;
+}
+} // namespace Game
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../Rendering/Mesh.h"
+
+#include <mutex>
+#include <vector>
+
+namespace Rendering
+{
+class Buffer;
+class Device;
+class Renderer;
+} // namespace Rendering
+
+namespace Wolf3dLoaders
+{
+struct Map;
+}
+
+namespace Game
+{
+// Wall mesh split into square chunks of tiles. Changing a wall only re-meshes the chunks that can see it.
+// All chunks share one vertex and index buffer, each chunk owns a fixed slot in them.
+class MapMesh
+{
+  public:
+    static constexpr int ChunkSize = 16;
+    // A face lies on a tile edge of the chunk (border included), each edge holds at most one.
+    static constexpr int MaxChunkQuads = 2 * ChunkSize * (ChunkSize + 1);
+
+    MapMesh() = default;
+    // Without a device there are no chunks, only the walls.
+    MapMesh(std::shared_ptr<Rendering::Device> device, const Wolf3dLoaders::Map& map);
+
+    // Texture layer of the wall on a tile, -1 when the tile is open.
+    int GetWall(int x, int z) const { return _walls[z * _width + x]; }
+    // Can run on the simulation thread while another thread renders and updates.
+    void SetWall(int x, int z, int layer);
+
+    // Re-meshes the chunks changed since the last update, the renderer copies them in ahead of the next frame's draws.
+    // Runs on the thread that records frames.
+    void Update(Rendering::Renderer& renderer);
+
+    std::vector<Rendering::Mesh>& GetChunks() { return _chunks; }
+
+  private:
+    void MarkDirty(int chunkX, int chunkZ);
+    // Staging buffer holding the dirty chunks and their copy regions, null when nothing changed.
+    std::shared_ptr<Rendering::Buffer> BuildDirtyChunks(std::vector<vk::BufferCopy>& vertexCopies, std::vector<vk::BufferCopy>& indexCopies);
+
+  private:
+    std::shared_ptr<Rendering::Device> _device;
+    std::mutex _wallsMutex; // walls and dirty flags, written by SetWall and read by Update
+    std::vector<int16_t> _walls;
+    int _width{};
+    int _chunksPerRow{};
+
+    std::shared_ptr<Rendering::Buffer> _vertexBuffer;
+    std::shared_ptr<Rendering::Buffer> _indexBuffer;
+
+    std::vector<Rendering::Mesh> _chunks;
+    std::vector<bool> _dirty;
+};
+} // namespace Game
\ No newline at end of file
@@ -13,6 +13,21 @@ struct Vertex
     glm::vec3 uvTile;
 };
 
+template <typename T>
+static Rendering::Mesh UploadMesh(std::shared_ptr<Rendering::Device> device, const std::vector<T>& verts, const std::vector<uint32_t>& indices)
+{
+    auto vertexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, (void*)verts.data(), verts.size() * sizeof(T));
+    auto indexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, (void*)indices.data(), indices.size() * sizeof(uint32_t));
+
+    auto vertexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eVertexBuffer, verts.size() * sizeof(T));
+    auto indexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eIndexBuffer, indices.size() * sizeof(uint32_t));
+
+    vertexBufferStaging->CopyTo(vertexBuffer);
+    indexBufferStaging->CopyTo(indexBuffer);
+
+    return {vertexBuffer, indexBuffer, (uint32_t)indices.size()};
+}
+
 static void GenerateCube(Vertex* verts, uint32_t* indices, uint32_t tileId)
 {
     const glm::vec3 normal{0.0f, 1.0f, 0.0f};
@@ -54,28 +69,23 @@ static void GenerateCube(Vertex* verts, uint32_t* indices, uint32_t tileId)
 
 Rendering::Mesh MeshGenerator::BuildFloorPlaneMesh(std::shared_ptr<Rendering::Device> device, int size)
 {
-    const glm::vec3 normal{0.0f, 1.0f, 0.0f};
+    const std::array<int8_t, 4> normal{0, 127, 0, 0};
     const uint32_t quadIndices[] = {0, 2, 1, 1, 2, 3};
 
-    std::vector<Vertex> verts(size * size * 4);
+    std::vector<PackedVertex> verts(size * size * 4);
     std::vector<uint32_t> indices(size * size * 6);
 
     for (int i = 0; i < size * size; i++)
     {
-        float r = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
-        float g = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
-        float b = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+        const std::array<uint8_t, 4> color{(uint8_t)(rand() & 0xFF), (uint8_t)(rand() & 0xFF), (uint8_t)(rand() & 0xFF), 0xFF};
 
-        verts[i * 4 + 0] = {glm::vec3{0.0f, 0.0f, 0.0f}, normal, glm::vec3{r, g, b}};
-        verts[i * 4 + 1] = {glm::vec3{1.0f, 0.0f, 0.0f}, normal, glm::vec3{r, g, b}};
-        verts[i * 4 + 2] = {glm::vec3{0.0f, 0.0f, 1.0f}, normal, glm::vec3{r, g, b}};
-        verts[i * 4 + 3] = {glm::vec3{1.0f, 0.0f, 1.0f}, normal, glm::vec3{r, g, b}};
+        const auto x = (int16_t)(i % size);
+        const auto z = (int16_t)(i / size);
 
-        for (auto v = 0; v < 4; v++)
-        {
-            verts[i * 4 + v].pos.x += (i % size);
-            verts[i * 4 + v].pos.z += (i / size);
-        }
+        verts[i * 4 + 0] = {{x, 0, z, 0}, normal, color};
+        verts[i * 4 + 1] = {{(int16_t)(x + 1), 0, z, 0}, normal, color};
+        verts[i * 4 + 2] = {{x, 0, (int16_t)(z + 1), 0}, normal, color};
+        verts[i * 4 + 3] = {{(int16_t)(x + 1), 0, (int16_t)(z + 1), 0}, normal, color};
 
         for (auto n = 0; n < 6; n++)
         {
@@ -83,16 +93,7 @@ Rendering::Mesh MeshGenerator::BuildFloorPlaneMesh(std::shared_ptr<Rendering::De
         }
     }
 
-    auto vertexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, verts.data(), verts.size() * sizeof(Vertex));
-    auto indexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, indices.data(), indices.size() * sizeof(uint32_t));
-
-    auto vertexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eVertexBuffer, verts.size() * sizeof(Vertex));
-    auto indexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eIndexBuffer, indices.size() * sizeof(uint32_t));
-
-    vertexBufferStaging->CopyTo(vertexBuffer);
-    indexBufferStaging->CopyTo(indexBuffer);
-
-    return {vertexBuffer, indexBuffer, (uint32_t)indices.size()};
+    return UploadMesh(device, verts, indices);
 }
 
 Rendering::Mesh MeshGenerator::BuildCubeMesh(std::shared_ptr<Rendering::Device> device)
@@ -102,40 +103,23 @@ Rendering::Mesh MeshGenerator::BuildCubeMesh(std::shared_ptr<Rendering::Device>
 
     GenerateCube(verts.data(), indices.data(), 0);
 
-    auto vertexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, verts.data(), verts.size() * sizeof(Vertex));
-    auto indexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, indices.data(), indices.size() * sizeof(uint32_t));
-
-    auto vertexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eVertexBuffer, verts.size() * sizeof(Vertex));
-    auto indexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eIndexBuffer, indices.size() * sizeof(uint32_t));
-
-    vertexBufferStaging->CopyTo(vertexBuffer);
-    indexBufferStaging->CopyTo(indexBuffer);
-
-    return {vertexBuffer, indexBuffer, (uint32_t)indices.size()};
+    return UploadMesh(device, verts, indices);
 }
 
-Rendering::Mesh MeshGenerator::BuildMapMesh(std::shared_ptr<Rendering::Device> device, const Wolf3dLoaders::Map& map)
+std::vector<int16_t> MeshGenerator::GetWallLayers(const Wolf3dLoaders::Map& map)
 {
-    const auto solidWallCount = std::count_if(std::begin(map.tiles[0]), std::end(map.tiles[0]), [](uint16_t i) { return i != 0 && i <= 53; });
+    std::vector<int16_t> walls(map.width * map.width, -1);
 
-    std::vector<Vertex> verts(solidWallCount * 6 * 4);
-    std::vector<uint32_t> indices(solidWallCount * 36);
-
-    uint32_t cubeIndex = 0;
-
-    for (int i = 0; i < map.width * map.width; i++)
+    for (int i = 0; i < (int)walls.size(); i++)
     {
+        const int x = i % map.width;
         int tileId = map.tiles[0][i];
 
         if (tileId == 0 || tileId > 53)
             continue;
 
-        // Handle secret doors as entities.
-        if (map.tiles[1][i] == 98)
-            continue;
-
         // Handle elevator as an entity.
-        if (tileId == 21 && (map.tiles[0][i - 1] >= 90 || map.tiles[0][i + 1] >= 90))
+        if (tileId == 21 && ((x > 0 && map.tiles[0][i - 1] >= 90) || (x + 1 < map.width && map.tiles[0][i + 1] >= 90)))
             continue;
 
         // Wolf has two images per tile (light and dark). Use only light version.
@@ -144,32 +128,99 @@ Rendering::Mesh MeshGenerator::BuildMapMesh(std::shared_ptr<Rendering::Device> d
         if (tileId % 2 != 0)
             tileId++;
 
-        GenerateCube(verts.data() + (cubeIndex * 24), indices.data() + (cubeIndex * 36), tileId);
+        walls[i] = (int16_t)tileId;
+    }
 
-        for (auto n = 0; n < 36; n++)
-        {
-            indices[cubeIndex * 36 + n] = indices[cubeIndex * 36 + n] + cubeIndex * 24;
-        }
+    return walls;
+}
 
-        for (auto v = 0; v < 24; v++)
-        {
-            verts[cubeIndex * 24 + v].pos.x += (i % map.width);
-            verts[cubeIndex * 24 + v].pos.y += 0.5f;
-            verts[cubeIndex * 24 + v].pos.z += (i / map.width);
-        }
+// Quad from start to end along the bottom edge, one texture repeat per tile. Matches the cube face winding.
+static void AddWallQuad(std::vector<PackedVertex>& verts, std::vector<uint32_t>& indices, glm::ivec2 start, glm::ivec2 end, const std::array<int8_t, 4>& normal, int tiles, int layer)
+{
+    assert(tiles < 256 && layer < 256);
 
-        cubeIndex++;
-    }
+    const auto base = (uint32_t)verts.size();
+    const auto u = (uint8_t)tiles;
+    const auto w = (uint8_t)layer;
 
-    auto vertexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, verts.data(), verts.size() * sizeof(Vertex));
-    auto indexBufferStaging = Rendering::Buffer::CreateStagingBuffer(device, indices.data(), indices.size() * sizeof(uint32_t));
+    verts.push_back({{(int16_t)start.x, 0, (int16_t)start.y, 0}, normal, {0, 1, w, 0}});
+    verts.push_back({{(int16_t)end.x, 0, (int16_t)end.y, 0}, normal, {u, 1, w, 0}});
+    verts.push_back({{(int16_t)end.x, 1, (int16_t)end.y, 0}, normal, {u, 0, w, 0}});
+    verts.push_back({{(int16_t)start.x, 1, (int16_t)start.y, 0}, normal, {0, 0, w, 0}});
 
-    auto vertexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eVertexBuffer, verts.size() * sizeof(Vertex));
-    auto indexBuffer = Rendering::Buffer::CreateGPUBuffer(device, vk::BufferUsageFlagBits::eIndexBuffer, indices.size() * sizeof(uint32_t));
+    for (auto index : {0u, 1u, 2u, 2u, 3u, 0u})
+        indices.push_back(base + index);
+}
 
-    vertexBufferStaging->CopyTo(vertexBuffer);
-    indexBufferStaging->CopyTo(indexBuffer);
+// Tile (x, z) covers [x, x + 1] and [z, z + 1], walls are one unit high.
+void MeshGenerator::BuildWallGeometry(const std::vector<int16_t>& walls, int width, glm::ivec2 origin, int size, std::vector<PackedVertex>& verts, std::vector<uint32_t>& indices)
+{
+    const glm::ivec2 end = glm::min(origin + size, glm::ivec2{width});
+
+    // A face is only visible towards an open tile inside the map. Floors and ceilings are never visible.
+    auto hasFace = [&](int x, int z, int dx, int dz) {
+        const int nx = x + dx;
+        const int nz = z + dz;
+        if (nx < 0 || nz < 0 || nx >= width || nz >= width)
+            return false;
+
+        return walls[z * width + x] >= 0 && walls[nz * width + nx] < 0;
+    };
+
+    // Faces along a row (or column) with the same texture are merged into one quad.
+    auto addFaces = [&](int dx, int dz) {
+        // Walk along x for north/south faces and along z for east/west faces.
+        const int lineFirst = dz != 0 ? origin.y : origin.x;
+        const int lineLast = dz != 0 ? end.y : end.x;
+        const int stepFirst = dz != 0 ? origin.x : origin.y;
+        const int stepLast = dz != 0 ? end.x : end.y;
+
+        for (int line = lineFirst; line < lineLast; line++)
+        {
+            auto tile = [&](int step) { return dz != 0 ? glm::ivec2{step, line} : glm::ivec2{line, step}; };
+
+            int run = stepFirst;
+            while (run < stepLast)
+            {
+                const auto first = tile(run);
+                if (!hasFace(first.x, first.y, dx, dz))
+                {
+                    run++;
+                    continue;
+                }
+
+                const int layer = walls[first.y * width + first.x];
+                int last = run;
+                while (last + 1 < stepLast)
+                {
+                    const auto next = tile(last + 1);
+                    if (!hasFace(next.x, next.y, dx, dz) || walls[next.y * width + next.x] != layer)
+                        break;
+                    last++;
+                }
+
+                const auto lastTile = tile(last);
+                const int tiles = last - run + 1;
+                const glm::ivec2 low{first.x, first.y};
+                const glm::ivec2 high{lastTile.x + 1, lastTile.y + 1};
+
+                if (dz > 0)
+                    AddWallQuad(verts, indices, {low.x, high.y}, {high.x, high.y}, {0, 0, 127, 0}, tiles, layer);
+                else if (dz < 0)
+                    AddWallQuad(verts, indices, {high.x, low.y}, {low.x, low.y}, {0, 0, -127, 0}, tiles, layer);
+                else if (dx < 0)
+                    AddWallQuad(verts, indices, {low.x, low.y}, {low.x, high.y}, {-127, 0, 0, 0}, tiles, layer);
+                else
+                    AddWallQuad(verts, indices, {high.x, high.y}, {high.x, low.y}, {127, 0, 0, 0}, tiles, layer);
+
+                run = last + 1;
+            }
+        }
+    };
 
-    return {vertexBuffer, indexBuffer, (uint32_t)indices.size()};
+    addFaces(0, 1);
+    addFaces(0, -1);
+    addFaces(-1, 0);
+    addFaces(1, 0);
 }
 } // namespace Game
\ No newline at end of file
@@ -11,11 +11,24 @@ class Device;
 
 namespace Game
 {
+// Vertex for meshes on the tile grid, where every coordinate is a whole number.
+// Attribute formats: R16G16B16A16Sint, R8G8B8A8Snorm, R8G8B8A8Uint (R8G8B8A8Unorm colour for the floor).
+struct PackedVertex
+{
+    std::array<int16_t, 4> pos;
+    std::array<int8_t, 4> normal;
+    std::array<uint8_t, 4> uvTile;
+};
+static_assert(sizeof(PackedVertex) == 16);
+
 class MeshGenerator
 {
   public:
     static Rendering::Mesh BuildFloorPlaneMesh(std::shared_ptr<Rendering::Device> device, int size);
     static Rendering::Mesh BuildCubeMesh(std::shared_ptr<Rendering::Device> device);
-    static Rendering::Mesh BuildMapMesh(std::shared_ptr<Rendering::Device> device, const Wolf3dLoaders::Map& map);
+    // Texture layer of every tile that is drawn as part of the wall mesh, -1 for open tiles and wall entities.
+    static std::vector<int16_t> GetWallLayers(const Wolf3dLoaders::Map& map);
+    // Appends the visible wall faces of the tiles in [origin, origin + size).
+    static void BuildWallGeometry(const std::vector<int16_t>& walls, int width, glm::ivec2 origin, int size, std::vector<PackedVertex>& verts, std::vector<uint32_t>& indices);
 };
 } // namespace Game
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "../Common.h"
+
+#include "Components.h"
+#include "Raycaster.h"
+
+#include <limits>
+
+namespace Game
+{
+Raycaster::Raycaster(int width, float tileSize)
+    : _width(width), _tileSize(tileSize)
+{
+    _cells.resize(width * width);
+}
+
+Raycaster::Cell* Raycaster::GetCell(const glm::ivec2& tile)
+{
+    if (tile.x < 0 || tile.y < 0 || tile.x >= _width || tile.y >= _width)
+        return nullptr;
+
+    const auto index = tile.y * _width + tile.x;
+    auto& cell = _cells[index];
+    if (cell.type == Cell::Type::Empty && cell.firstSprite < 0)
+        _usedCells.push_back(index);
+    return &cell;
+}
+
+void Raycaster::Update(entt::registry& registry)
+{
+    for (const auto index : _usedCells)
+        _cells[index] = {};
+    _usedCells.clear();
+    _sprites.clear();
+
+    auto tileOf = [&](const glm::vec3& pos) { return glm::ivec2{glm::floor(glm::vec2{pos.x, pos.z} / _tileSize)}; };
+
+    auto doorView = registry.view<Transform, Door>();
+    for (auto [entity, xform, door] : doorView.each())
+    {
+        // doorClosedPos is only known once the door has been opened.
+        const auto closed = door.state == Door::State::Closed;
+        auto cell = GetCell(tileOf(closed ? xform.position : door.doorClosedPos));
+        if (cell == nullptr)
+            continue;
+
+        cell->type = Cell::Type::Door;
+        cell->vertical = door.flags & DoorVertical;
+        cell->doorOffset = closed ? 0.0f : glm::distance(xform.position, door.doorClosedPos);
+        cell->entity = entity;
+    }
+
+    // Closed pushwalls aren't in the grid, moving ones block the tile they are on.
+    auto secretDoorView = registry.view<Transform, SecretDoor>();
+    for (auto [entity, xform, door] : secretDoorView.each())
+    {
+        if (door.state == SecretDoor::State::Open)
+            continue;
+
+        auto cell = GetCell(tileOf(xform.position));
+        if (cell == nullptr)
+            continue;
+
+        cell->type = Cell::Type::Pushwall;
+        cell->entity = entity;
+    }
+
+    auto enemyView = registry.view<Transform, Enemy>();
+    for (auto [entity, xform, enemy] : enemyView.each())
+    {
+        auto cell = GetCell(tileOf(xform.position));
+        if (cell == nullptr)
+            continue;
+
+        _sprites.push_back({{xform.position.x, xform.position.z}, entity, cell->firstSprite});
+        cell->firstSprite = (int)_sprites.size() - 1;
+    }
+}
+
+RayHit Raycaster::Trace(const CollisionGrid& grid, const Ray& ray, bool hitSprites) const
+{
+    constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+    RayHit hit{};
+    hit.distance = ray.maxDistance;
+
+    const auto& o = ray.origin;
+    const auto& d = ray.direction;
+
+    glm::ivec2 tile{glm::floor(o / _tileSize)};
+    const glm::ivec2 step{d.x < 0.0f ? -1 : 1, d.y < 0.0f ? -1 : 1};
+
+    // Ray distance to cross one tile, and to the next tile edge, along each axis.
+    const glm::vec2 tDelta{d.x != 0.0f ? _tileSize / glm::abs(d.x) : Infinity, d.y != 0.0f ? _tileSize / glm::abs(d.y) : Infinity};
+    glm::vec2 tMax{
+        d.x != 0.0f ? ((step.x > 0 ? tile.x + 1 : tile.x) * _tileSize - o.x) / d.x : Infinity,
+        d.y != 0.0f ? ((step.y > 0 ? tile.y + 1 : tile.y) * _tileSize - o.y) / d.y : Infinity,
+    };
+
+    float tEnter = 0.0f;
+    while (tEnter <= hit.distance)
+    {
+        if (grid.Test(tile, TileBlocksShooting))
+        {
+            hit = {RayHit::Type::Wall, tEnter, tile, entt::null};
+            return hit;
+        }
+
+        const auto tExit = glm::min(tMax.x, tMax.y);
+        const auto& cell = _cells[tile.y * _width + tile.x];
+
+        if (cell.type == Cell::Type::Pushwall)
+        {
+            hit = {RayHit::Type::Wall, tEnter, tile, cell.entity};
+            return hit;
+        }
+
+        if (cell.type == Cell::Type::Door)
+        {
+            // Slab through the tile centre, the part slid past the tile edge is open.
+            const auto axis = cell.vertical ? 0 : 1;
+            const auto along = 1 - axis;
+            if (d[axis] != 0.0f)
+            {
+                const auto t = ((tile[axis] + 0.5f) * _tileSize - o[axis]) / d[axis];
+                const auto slide = o[along] + d[along] * t - tile[along] * _tileSize;
+                if (t >= tEnter && t <= tExit && t <= hit.distance && slide >= cell.doorOffset)
+                    hit = {RayHit::Type::Door, t, tile, cell.entity};
+            }
+        }
+
+        if (hitSprites)
+        {
+            for (auto i = cell.firstSprite; i >= 0; i = _sprites[i].next)
+            {
+                const auto& sprite = _sprites[i];
+                const auto m = o - sprite.position;
+                const auto b = glm::dot(m, d);
+                const auto c = glm::dot(m, m) - SpriteRadius * SpriteRadius;
+                const auto discriminant = b * b - c;
+                if ((c > 0.0f && b > 0.0f) || discriminant < 0.0f)
+                    continue;
+
+                const auto t = glm::max(-b - glm::sqrt(discriminant), 0.0f);
+                if (t < hit.distance)
+                    hit = {RayHit::Type::Sprite, t, tile, sprite.entity};
+            }
+        }
+
+        if (hit.type != RayHit::Type::None)
+            return hit;
+
+        if (tMax.x < tMax.y)
+        {
+            tile.x += step.x;
+            tEnter = tMax.x;
+            tMax.x += tDelta.x;
+        }
+        else
+        {
+            tile.y += step.y;
+            tEnter = tMax.y;
+            tMax.y += tDelta.y;
+        }
+    }
+
+    return hit;
+}
+
+void Raycaster::Trace(const CollisionGrid& grid, std::span<const Ray> rays, std::span<RayHit> hits, bool hitSprites) const
+{
+    assert(rays.size() == hits.size());
+
+    for (size_t i = 0; i < rays.size(); i++)
+        hits[i] = Trace(grid, rays[i], hitSprites);
+}
+} // namespace Game
\ No newline at end of file
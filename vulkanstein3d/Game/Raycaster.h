@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CollisionGrid.h"
+
+#include "entt/entt.hpp"
+
+#include <span>
+#include <vector>
+
+namespace Game
+{
+// World space ray on the x/z plane, direction normalized.
+struct Ray
+{
+    glm::vec2 origin{0.0f};
+    glm::vec2 direction{1.0f, 0.0f};
+    float maxDistance{0.0f};
+};
+
+struct RayHit
+{
+    enum class Type : uint8_t
+    {
+        None,
+        Wall,
+        Door,
+        Sprite
+    };
+    Type type{Type::None};
+    float distance{0.0f}; // maxDistance of the ray when nothing was hit
+    glm::ivec2 tile{0};
+    entt::entity entity{entt::null}; // door, moving pushwall or enemy
+};
+
+// Amanatides-Woo grid traversal over the collision grid's TileBlocksShooting tiles. Doors are thin slabs through the tile
+// centre that block the part not yet slid open, enemies are circles on their tile.
+class Raycaster
+{
+  public:
+    static constexpr float SpriteRadius = 3.0f;
+
+    Raycaster() = default;
+    Raycaster(int width, float tileSize);
+
+    // Picks up door, pushwall and enemy positions, call once per update after they have moved.
+    void Update(entt::registry& registry);
+
+    RayHit Trace(const CollisionGrid& grid, const Ray& ray, bool hitSprites) const;
+    // Traces rays[i] into hits[i], the spans must be the same size.
+    void Trace(const CollisionGrid& grid, std::span<const Ray> rays, std::span<RayHit> hits, bool hitSprites) const;
+
+  private:
+    struct Cell
+    {
+        enum class Type : uint8_t
+        {
+            Empty,
+            Door,
+            Pushwall
+        };
+        Type type{Type::Empty};
+        bool vertical{false}; // door slides along z
+        int firstSprite{-1};
+        float doorOffset{0.0f}; // how far the door has slid open
+        entt::entity entity{entt::null};
+    };
+
+    struct SpriteEntry
+    {
+        glm::vec2 position;
+        entt::entity entity;
+        int next;
+    };
+
+    Cell* GetCell(const glm::ivec2& tile);
+
+  private:
+    int _width{};
+    float _tileSize{1.0f};
+    std::vector<Cell> _cells;
+    std::vector<int> _usedCells; // reset on the next update, the rest stay empty
+    std::vector<SpriteEntry> _sprites;
+};
+} // namespace Game
\ No newline at end of file
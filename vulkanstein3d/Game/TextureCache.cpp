@@ -0,0 +1,133 @@
+#include "../Common.h"
+
+#include "TextureCache.h"
+
+#include "../Rendering/Buffer.h"
+
+#include "../Wolf3dLoaders/FileView.h"
+
+#include "xbrz/xbrz.h"
+
+#include <fstream>
+
+namespace Game
+{
+// Bump when the layout of cached data changes, stale entries are then ignored.
+constexpr uint32_t CacheVersion = 2;
+constexpr uint32_t CacheMagic = 0x43545356; // "VSTC"
+
+struct CacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t size;
+};
+
+// FNV-1a
+static uint64_t Hash(uint64_t hash, const void* data, size_t size)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+TextureCache::TextureCache(const std::filesystem::path& cachePath)
+    : _cachePath(cachePath)
+{
+}
+
+uint64_t TextureCache::ComputeKey(const std::vector<const uint32_t*>& layers, int width, int height, int scaleFactor, const xbrz::ScalerCfg& cfg, uint32_t format)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    const int32_t dimensions[] = {width, height, (int32_t)layers.size(), scaleFactor, (int32_t)format};
+    hash = Hash(hash, &CacheVersion, sizeof(CacheVersion));
+    hash = Hash(hash, dimensions, sizeof(dimensions));
+
+    const double config[] = {cfg.luminanceWeight, cfg.equalColorTolerance, cfg.centerDirectionBias, cfg.dominantDirectionThreshold, cfg.steepDirectionThreshold};
+    hash = Hash(hash, config, sizeof(config));
+
+    for (auto layer : layers)
+        hash = Hash(hash, layer, (size_t)width * height * sizeof(uint32_t));
+
+    return hash;
+}
+
+std::shared_ptr<Rendering::Buffer> TextureCache::Load(std::shared_ptr<Rendering::Device> device, uint64_t key, size_t size)
+{
+    const auto path = GetEntryPath(key);
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+        return nullptr;
+
+    auto file = Wolf3dLoaders::FileView::Open(path);
+    if (!file)
+        return nullptr;
+
+    const auto headerData = file->Slice(0, sizeof(CacheHeader));
+    if (headerData.empty())
+        return nullptr;
+
+    CacheHeader header{};
+    std::memcpy(&header, headerData.data(), sizeof(CacheHeader));
+
+    const auto data = file->Slice(sizeof(CacheHeader), size);
+    if (header.magic != CacheMagic || header.version != CacheVersion || header.key != key || header.size != size || data.empty())
+    {
+        spdlog::warn("[Game] Ignoring stale texture cache entry '{}'", path.string());
+        return nullptr;
+    }
+
+    return Rendering::Buffer::CreateStagingBuffer(device, const_cast<uint8_t*>(data.data()), size);
+}
+
+void TextureCache::Store(uint64_t key, const void* data, size_t size)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(_cachePath, ec);
+
+    // Write to a temporary file first so an interrupted write never leaves a truncated entry behind.
+    const auto path = GetEntryPath(key);
+    auto tempPath = path;
+    tempPath += ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            spdlog::warn("[Game] Couldn't write texture cache entry '{}'", path.string());
+            return;
+        }
+
+        const CacheHeader header{CacheMagic, CacheVersion, key, size};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data), size);
+
+        if (!file)
+        {
+            spdlog::warn("[Game] Couldn't write texture cache entry '{}'", path.string());
+            file.close();
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+    {
+        spdlog::warn("[Game] Couldn't replace texture cache entry '{}': {}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+    }
+}
+
+std::filesystem::path TextureCache::GetEntryPath(uint64_t key) const
+{
+    return _cachePath / fmt::format("{:016x}.bin", key);
+}
+} // namespace Game
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace Rendering
+{
+class Buffer;
+class Device;
+} // namespace Rendering
+
+namespace xbrz
+{
+struct ScalerCfg;
+}
+
+namespace Game
+{
+// Upscaled texture layers stored on disk, keyed by a hash of the source pixels and the scaler settings.
+class TextureCache
+{
+  public:
+    TextureCache(const std::filesystem::path& cachePath);
+
+    // format is the vk::Format the layers are stored in.
+    static uint64_t ComputeKey(const std::vector<const uint32_t*>& layers, int width, int height, int scaleFactor, const xbrz::ScalerCfg& cfg, uint32_t format);
+
+    // Copies a cached entry from its mapped file into a new staging buffer, returns nullptr on a miss.
+    std::shared_ptr<Rendering::Buffer> Load(std::shared_ptr<Rendering::Device> device, uint64_t key, size_t size);
+    void Store(uint64_t key, const void* data, size_t size);
+
+  private:
+    std::filesystem::path GetEntryPath(uint64_t key) const;
+
+    std::filesystem::path _cachePath;
+};
+} // namespace Game
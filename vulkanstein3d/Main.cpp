@@ -1,6 +1,8 @@
 ﻿#include "Common.h"
 
 #include "App/Input.h"
+#include "App/JobSystem.h"
+#include "App/TripleBuffer.h"
 #include "App/Window.h"
 #include "Game/Assets.h"
 #include "Game/Components.h"
@@ -10,8 +12,10 @@
 #include "Rendering/Renderer.h"
 #include "Wolf3dLoaders/Loaders.h"
 
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <thread>
 
 struct HudPushConstants
 {
@@ -23,11 +27,7 @@ struct HudPushConstants
 
 struct ObjectPushConstants
 {
-    glm::mat4 mvp{1.0f};
-    float tileIndex;
-    float padding0;
-    float padding1;
-    float padding2;
+    glm::mat4 viewProjection{1.0f};
 };
 
 struct FrameConstants
@@ -50,78 +50,199 @@ struct FrameConstantsUBO
 };
 
 struct Sprite
+{
+    glm::vec3 position;
+    uint32_t spriteIndex;
+};
+static_assert(sizeof(Sprite) == 16);
+
+// Doors, pushwalls and elevator switches, data.x is the wall texture layer.
+struct ObjectInstance
 {
     glm::mat4 model{1.0f};
     glm::vec4 data;
 };
 
-void CreateMaterials(std::shared_ptr<Rendering::Device> device, Game::Assets& assets,
-                     std::shared_ptr<Rendering::Buffer> frameUbo, std::shared_ptr<Rendering::Buffer> storage)
+// The simulation runs at the original game's 70 Hz, rendering interpolates between ticks.
+constexpr double TickTime = 1.0 / 70.0;
+// Longer frames (hitches, level loads) slow the game down instead of running a burst of ticks.
+constexpr int MaxTicksPerFrame = 5;
+
+// Distance from an elevator at which the level behind it starts loading.
+constexpr float LevelPrefetchRange = 60.0f;
+
+// Level being loaded on a worker, swapped in when the player takes the elevator.
+struct LevelPrefetch
 {
+    int episode{};
+    int floor{};
+    std::future<std::shared_ptr<Game::Level>> level;
+};
 
-    auto hudPipeline = Rendering::PipelineBuilder::Builder()
-                           .SetDepthState(false, false)
-                           .SetRasterization(vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise)
-                           .SetShaders("Shaders/mat_hud.vert.spv", "Shaders/mat_hud.frag.spv")
-                           .Build(device);
+struct SpriteSnapshot
+{
+    glm::vec3 previousPosition;
+    glm::vec3 position;
+    uint32_t spriteIndex;
+};
 
-    assets.AddMaterial("mat_hud_loading", Rendering::MaterialBuilder::Builder()
-                                              .SetPipeline(hudPipeline)
-                                              .SetTexture(0, assets.GetTexture("tex_gui_loading"))
-                                              .Build(device));
+struct ObjectSnapshot
+{
+    glm::vec3 previousPosition;
+    glm::vec3 position;
+    glm::vec3 scale;
+    int tileIndex;
+};
 
-    assets.AddMaterial("mat_hud_intro", Rendering::MaterialBuilder::Builder()
-                                            .SetPipeline(hudPipeline)
-                                            .SetTexture(0, assets.GetTexture("tex_gui_intro"))
-                                            .Build(device));
+// What rendering needs from a tick, so it never reads the registry and can run on its own thread.
+struct RenderSnapshot
+{
+    std::shared_ptr<Game::Level> level; // map and floor meshes
+    double tickTime{};                  // time the tick was simulated for, rendering interpolates from it
+    glm::ivec2 mousePos{};
 
-    assets.AddMaterial("mat_hud_weapons", Rendering::MaterialBuilder::Builder()
-                                              .SetPipeline(hudPipeline)
-                                              .SetTexture(0, assets.GetTexture("tex_gui_weapons"))
-                                              .Build(device));
+    glm::vec3 previousCameraPosition{};
+    glm::vec3 cameraPosition{};
+    glm::vec3 cameraFront{};
+    glm::vec3 cameraUp{};
 
-    assets.AddMaterial("mat_hud_keys", Rendering::MaterialBuilder::Builder()
-                                           .SetPipeline(hudPipeline)
-                                           .SetTexture(0, assets.GetTexture("tex_gui_keys"))
-                                           .Build(device));
+    std::vector<SpriteSnapshot> sprites;
+    std::vector<ObjectSnapshot> objects;
 
-    assets.AddMaterial("mat_hud_sprites", Rendering::MaterialBuilder::Builder()
-                                              .SetPipeline(hudPipeline)
-                                              .SetTexture(0, assets.GetTexture("tex_sprites"))
-                                              .Build(device));
+    Game::Level::Weapon weapon{};
+    int weaponFrameOffset{};
+    float weaponChangeOffset{};
+};
+
+// Reuses the snapshot's vectors, the slots of the triple buffer stop allocating once they have grown.
+void CaptureSnapshot(std::shared_ptr<Game::Level> level, double tickTime, glm::ivec2 mousePos, RenderSnapshot& snapshot)
+{
+    auto& registry = level->GetRegistry();
+
+    snapshot.level = level;
+    snapshot.tickTime = tickTime;
+    snapshot.mousePos = mousePos;
+
+    const auto player = level->GetPlayerEntity();
+    const auto& fpsCamera = registry.get<Game::FPSCamera>(player);
+    snapshot.previousCameraPosition = level->GetPreviousPosition(player);
+    snapshot.cameraPosition = registry.get<Game::Transform>(player).position;
+    snapshot.cameraFront = fpsCamera.front;
+    snapshot.cameraUp = fpsCamera.up;
+
+    snapshot.sprites.clear();
+    auto itemview = registry.view<Game::Transform, Game::Sprite>();
+    for (auto [entity, itemtransform, csprite] : itemview.each())
+    {
+        snapshot.sprites.push_back({level->GetPreviousPosition(entity), itemtransform.position, (uint32_t)csprite.spriteIndex});
+    }
+
+    snapshot.objects.clear();
+    auto rendeables = registry.view<Game::Transform, Game::Renderable>();
+    for (auto [entity, xform, renderable] : rendeables.each())
+    {
+        snapshot.objects.push_back({level->GetPreviousPosition(entity), xform.position, xform.scale, renderable.tileIndex});
+    }
+
+    snapshot.weapon = level->_currentWeapon;
+    snapshot.weaponFrameOffset = level->_weaponFrameOffset;
+    snapshot.weaponChangeOffset = level->_weaponChangeOffset;
+}
+
+constexpr size_t InitialSprites = 512; // the sprite buffer grows past this as needed
+constexpr size_t InitialObjectInstances = 512; // grows like the sprite buffer
+
+// Data written every frame, bound with dynamic offsets into the current frame's region.
+struct FrameBuffers
+{
+    std::shared_ptr<Rendering::DynamicBuffer> constants;
+    std::shared_ptr<Rendering::DynamicBuffer> sprites;
+    std::shared_ptr<Rendering::DynamicBuffer> objects;
+};
+
+FrameBuffers CreateFrameBuffers(std::shared_ptr<Rendering::Device> device, uint32_t framesInFlight)
+{
+    FrameBuffers buffers;
+    buffers.constants = Rendering::DynamicBuffer::CreateDynamicBuffer(device, vk::BufferUsageFlagBits::eUniformBuffer, sizeof(FrameConstantsUBO), sizeof(FrameConstantsUBO), framesInFlight);
+    buffers.sprites = Rendering::DynamicBuffer::CreateDynamicBuffer(device, vk::BufferUsageFlagBits::eStorageBuffer, sizeof(Sprite) * InitialSprites, sizeof(Sprite) * InitialSprites, framesInFlight);
+    buffers.objects = Rendering::DynamicBuffer::CreateDynamicBuffer(device, vk::BufferUsageFlagBits::eStorageBuffer, sizeof(ObjectInstance) * InitialObjectInstances, sizeof(ObjectInstance) * InitialObjectInstances, framesInFlight);
+    return buffers;
+}
+
+// Indexed materials resolve colours through a palette buffer next to the texture.
+Rendering::MaterialBuilder TexturedMaterial(Game::Assets& assets, std::shared_ptr<Rendering::Pipeline> pipeline, const std::string& texture, const std::string& palette, uint32_t paletteBinding = 1)
+{
+    auto builder = Rendering::MaterialBuilder::Builder().SetPipeline(pipeline).SetTexture(0, assets.GetTexture(texture));
+    if (assets.GetTextureMode() == Game::TextureMode::Indexed)
+        builder.SetBuffer(paletteBinding, assets.GetBuffer(palette));
+    return builder;
+}
+
+// Rebuilt whenever the sprite buffer grows, the descriptor set points at the buffer itself.
+std::shared_ptr<Rendering::Material> CreateSpriteMaterial(std::shared_ptr<Rendering::Device> device, Game::Assets& assets, std::shared_ptr<Rendering::Pipeline> pipeline, const FrameBuffers& frameBuffers)
+{
+    return TexturedMaterial(assets, pipeline, "tex_sprites", "buf_palette_transparent", 3)
+        .SetBuffer(1, frameBuffers.constants)
+        .SetBuffer(2, frameBuffers.sprites)
+        .Build(device);
+}
+
+// Same for the object instance buffer.
+std::shared_ptr<Rendering::Material> CreateObjectMaterial(std::shared_ptr<Rendering::Device> device, Game::Assets& assets, std::shared_ptr<Rendering::Pipeline> pipeline, const FrameBuffers& frameBuffers)
+{
+    return TexturedMaterial(assets, pipeline, "tex_walls", "buf_palette")
+        .SetBuffer(2, frameBuffers.objects)
+        .Build(device);
+}
+
+void CreateMaterials(std::shared_ptr<Rendering::Device> device, Game::Assets& assets, const FrameBuffers& frameBuffers)
+{
+
+    const bool indexed = assets.GetTextureMode() == Game::TextureMode::Indexed;
+    auto fragShader = [indexed](const std::string& name) { return "Shaders/" + name + (indexed ? "_indexed" : "") + ".frag.spv"; };
+
+    auto hudPipeline = Rendering::PipelineBuilder::Builder()
+                           .SetDepthState(false, false)
+                           .SetRasterization(vk::CullModeFlagBits::eNone, vk::FrontFace::eCounterClockwise)
+                           .SetShaders("Shaders/mat_hud.vert.spv", fragShader("mat_hud"))
+                           .Build(device);
+
+    assets.AddMaterial("mat_hud_loading", TexturedMaterial(assets, hudPipeline, "tex_gui_loading", "buf_palette").Build(device));
+    assets.AddMaterial("mat_hud_intro", TexturedMaterial(assets, hudPipeline, "tex_gui_intro", "buf_palette").Build(device));
+    assets.AddMaterial("mat_hud_weapons", TexturedMaterial(assets, hudPipeline, "tex_gui_weapons", "buf_palette").Build(device));
+    assets.AddMaterial("mat_hud_keys", TexturedMaterial(assets, hudPipeline, "tex_gui_keys", "buf_palette").Build(device));
+    assets.AddMaterial("mat_hud_sprites", TexturedMaterial(assets, hudPipeline, "tex_sprites", "buf_palette_transparent").Build(device));
 
     auto mapPipeline = Rendering::PipelineBuilder::Builder()
-                           .SetShaders("Shaders/mat_map.vert.spv", "Shaders/mat_map.frag.spv")
+                           .SetShaders("Shaders/mat_map.vert.spv", fragShader("mat_map"))
+                           .SetVertexAttributeFormat(0, vk::Format::eR16G16B16A16Sint)
+                           .SetVertexAttributeFormat(1, vk::Format::eR8G8B8A8Snorm)
+                           .SetVertexAttributeFormat(2, vk::Format::eR8G8B8A8Uint)
                            .Build(device);
 
-    assets.AddMaterial("mat_map", Rendering::MaterialBuilder::Builder()
-                                      .SetPipeline(mapPipeline)
-                                      .SetTexture(0, assets.GetTexture("tex_walls"))
-                                      .Build(device));
+    assets.AddMaterial("mat_map", TexturedMaterial(assets, mapPipeline, "tex_walls", "buf_palette").Build(device));
 
     auto objectPipeline = Rendering::PipelineBuilder::Builder()
-                              .SetShaders("Shaders/mat_object.vert.spv", "Shaders/mat_object.frag.spv")
+                              .SetShaders("Shaders/mat_object.vert.spv", fragShader("mat_object"))
+                              .SetDynamicBinding(2)
                               .Build(device);
 
-    assets.AddMaterial("mat_object", Rendering::MaterialBuilder::Builder()
-                                         .SetPipeline(objectPipeline)
-                                         .SetTexture(0, assets.GetTexture("tex_walls"))
-                                         .Build(device));
+    assets.AddMaterial("mat_object", CreateObjectMaterial(device, assets, objectPipeline, frameBuffers));
 
     auto spritePipeline = Rendering::PipelineBuilder::Builder()
-                              .SetShaders("Shaders/mat_sprite.vert.spv", "Shaders/mat_sprite.frag.spv")
+                              .SetShaders("Shaders/mat_sprite.vert.spv", fragShader("mat_sprite"))
+                              .SetDynamicBinding(1)
+                              .SetDynamicBinding(2)
                               .SetBlend(true)
                               .Build(device);
 
-    assets.AddMaterial("mat_sprites", Rendering::MaterialBuilder::Builder()
-                                          .SetPipeline(spritePipeline)
-                                          .SetTexture(0, assets.GetTexture("tex_sprites"))
-                                          .SetBuffer(1, frameUbo)
-                                          .SetBuffer(2, storage)
-                                          .Build(device));
+    assets.AddMaterial("mat_sprites", CreateSpriteMaterial(device, assets, spritePipeline, frameBuffers));
 
     auto groundPipeline = Rendering::PipelineBuilder::Builder()
                               .SetShaders("Shaders/mat_ground.vert.spv", "Shaders/mat_ground.frag.spv")
+                              .SetVertexAttributeFormat(0, vk::Format::eR16G16B16A16Sint)
+                              .SetVertexAttributeFormat(1, vk::Format::eR8G8B8A8Snorm)
+                              .SetVertexAttributeFormat(2, vk::Format::eR8G8B8A8Unorm)
                               .Build(device);
 
     assets.AddMaterial("mat_ground", Rendering::MaterialBuilder::Builder()
@@ -135,29 +256,72 @@ int main(int argc, char* argv[])
 
     if (argc < 2)
     {
-        spdlog::warn("Pass path to Wolf3D directory as an argument.");
+        spdlog::warn("Pass path to Wolf3D directory as an argument, add --indexed for palette indexed textures and --pipelined to render on a separate thread.");
         return 1;
     }
 
     std::filesystem::path dataPath = argv[1];
 
+    auto textureMode = Game::TextureMode::Upscaled;
+    bool pipelined = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (std::string_view(argv[i]) == "--indexed")
+            textureMode = Game::TextureMode::Indexed;
+        // Simulation on the main thread, recording and submitting frames on a render thread.
+        if (std::string_view(argv[i]) == "--pipelined")
+            pipelined = true;
+    }
+
     auto window = std::make_shared<App::Window>();
     Rendering::Renderer renderer{window};
 
-    Game::Assets assets{renderer._device, dataPath};
+    Game::Assets assets{renderer._device, dataPath, textureMode};
     Wolf3dLoaders::Loaders loaders{dataPath};
 
     int levelIndex = 0;
     auto level = std::make_shared<Game::Level>(renderer, loaders.LoadMap((levelIndex / 10) + 1, (levelIndex % 10) + 1));
 
+    LevelPrefetch prefetch;
+    auto prefetchLevel = [&](int episode, int floor) {
+        if (prefetch.level.valid() && prefetch.episode == episode && prefetch.floor == floor)
+            return;
+
+        // One load at a time, a switch to another elevator waits for the current load to finish.
+        if (prefetch.level.valid() && prefetch.level.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+            return;
+
+        // Map decoding, meshing and entity creation run on the worker, GPU data goes through the upload batches.
+        prefetch = {episode, floor, App::JobSystem::The().Async([&renderer, &loaders, episode, floor]() {
+                        return std::make_shared<Game::Level>(renderer, loaders.LoadMap(episode, floor));
+                    })};
+    };
+    auto changeLevel = [&](int episode, int floor) {
+        std::shared_ptr<Game::Level> nextLevel;
+        if (prefetch.level.valid() && prefetch.episode == episode && prefetch.floor == floor)
+            nextLevel = prefetch.level.get();
+        else
+        {
+            // A load for another floor still uses the renderer and loaders, it finishes before this one starts.
+            if (prefetch.level.valid())
+                prefetch.level.wait();
+            nextLevel = std::make_shared<Game::Level>(renderer, loaders.LoadMap(episode, floor));
+        }
+
+        prefetch = {};
+
+        // Rendering retires the old level once it has moved on to the new one.
+        level = nextLevel;
+    };
+
     auto cubeMesh = Game::MeshGenerator::BuildCubeMesh(renderer._device);
 
-    std::vector<Sprite> spriteModelMats;
+    std::vector<Sprite> sprites;
+    std::vector<ObjectInstance> objectInstances;
 
-    auto frameConstsUbo = Rendering::Buffer::CreateUniformBuffer(renderer._device, sizeof(FrameConstantsUBO));
-    auto modelStorage = Rendering::Buffer::CreateStorageBuffer(renderer._device, sizeof(Sprite) * 512);
+    auto frameBuffers = CreateFrameBuffers(renderer._device, renderer.GetFramesInFlight());
 
-    CreateMaterials(renderer._device, assets, frameConstsUbo, modelStorage);
+    CreateMaterials(renderer._device, assets, frameBuffers);
 
     auto groundMaterial = assets.GetMaterial("mat_ground");
     auto mapMaterial = assets.GetMaterial("mat_map");
@@ -165,91 +329,98 @@ int main(int argc, char* argv[])
     auto hudMaterial = assets.GetMaterial("mat_hud_sprites");
     auto objectMaterial = assets.GetMaterial("mat_object");
 
-    auto prevTime = std::chrono::high_resolution_clock::now();
-    double totalTime{};
-    auto& input = App::Input::The();
-    while (!glfwWindowShouldClose(window->Get()))
-    {
-        input.Update();
-        glfwPollEvents();
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    auto elapsed = [startTime]() { return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count(); };
 
-        auto nowTime = std::chrono::high_resolution_clock::now();
-        auto timeSpan = std::chrono::duration_cast<std::chrono::duration<double>>(nowTime - prevTime);
-        prevTime = nowTime;
-        auto delta = timeSpan.count();
-        totalTime += delta;
+    // Only touched by whichever thread renders.
+    std::shared_ptr<Game::Level> drawnLevel;
+    auto renderSnapshot = [&](const RenderSnapshot& snapshot) {
+        const auto totalTime = elapsed();
+        const auto alpha = (float)glm::clamp((totalTime - snapshot.tickTime) / TickTime, 0.0, 1.0);
 
-        level->Update(delta);
+        auto& level = *snapshot.level;
 
-        if (level->GetState() == Game::Level::LevelState::GoToNextLevel)
+        // Frames in flight may still draw the old level.
+        if (snapshot.level != drawnLevel)
         {
-            // todo, handle return from secret level (to back to proper level order)
-            levelIndex++;
-            level = std::make_shared<Game::Level>(renderer, loaders.LoadMap((levelIndex / 10) + 1, (levelIndex % 10) + 1));
-            continue;
-        }
-        if (level->GetState() == Game::Level::LevelState::GoToSecretLevel)
-        {
-            level = std::make_shared<Game::Level>(renderer, loaders.LoadMap((levelIndex / 10) + 1, 10));
-            continue;
+            if (drawnLevel != nullptr)
+                renderer.Retire(drawnLevel);
+            drawnLevel = snapshot.level;
         }
 
-        auto& registry = level->GetRegistry();
+        // Walls changed by the simulation, copied on the graphics queue ahead of this frame.
+        level._mapMesh.Update(renderer);
 
-        spriteModelMats.clear();
-        auto itemview = registry.view<Game::Transform, Game::Sprite>();
-        for (auto [entity, itemtransform, csprite] : itemview.each())
+        sprites.clear();
+        for (const auto& sprite : snapshot.sprites)
+            sprites.push_back({glm::mix(sprite.previousPosition, sprite.position, alpha), sprite.spriteIndex});
+
+        objectInstances.clear();
+        for (const auto& object : snapshot.objects)
         {
-            Sprite sprite;
-            sprite.model = glm::translate(glm::mat4{1.0f}, itemtransform.position);
-            sprite.data = glm::vec4((float)csprite.spriteIndex);
-            spriteModelMats.push_back(sprite);
+            ObjectInstance instance;
+            instance.model = glm::translate(glm::mat4{1.0f}, glm::mix(object.previousPosition, object.position, alpha)) * glm::scale(glm::mat4{1.0f}, object.scale);
+            instance.data = glm::vec4((float)object.tileIndex);
+            objectInstances.push_back(instance);
         }
-        modelStorage->SetData((void*)spriteModelMats.data(), sizeof(Sprite) * spriteModelMats.size());
 
-        auto mousepos = input.GetMousePos();
+        auto mousepos = snapshot.mousePos;
 
-        const auto& playerXform = registry.get<Game::Transform>(level->GetPlayerEntity());
-        const auto& fpsCamera = registry.get<Game::FPSCamera>(level->GetPlayerEntity());
+        const auto cameraPosition = glm::mix(snapshot.previousCameraPosition, snapshot.cameraPosition, alpha);
 
-        auto view = glm::lookAt(playerXform.position, playerXform.position + fpsCamera.front, fpsCamera.up);
+        auto view = glm::lookAt(cameraPosition, cameraPosition + snapshot.cameraFront, snapshot.cameraUp);
         auto proj = glm::perspective(glm::radians(65.0f), renderer._swapchain->GetExtent().width / (float)renderer._swapchain->GetExtent().height, 0.1f, 500.0f);
 
         FrameConstants consts{(float)totalTime, (float)mousepos.x / (float)renderer._swapchain->GetExtent().width, (float)mousepos.y / (float)renderer._swapchain->GetExtent().height, 0.0f};
         FrameConstantsUBO constsUbo{view, proj, (float)totalTime, (float)mousepos.x / (float)renderer._swapchain->GetExtent().width, (float)mousepos.y / (float)renderer._swapchain->GetExtent().height, 0.0f};
 
-        frameConstsUbo->SetData((void*)&constsUbo, sizeof(FrameConstantsUBO));
-
         if (!renderer.Begin())
+            return false;
+
+        // Frames in flight keep reading the old buffers and materials until they finish.
+        if (auto replaced = frameBuffers.sprites->Reserve(sizeof(Sprite) * sprites.size()))
         {
-            // Couldn't begin rendering (window hidden, swapchain borked, etc.), try again later.
-            glfwWaitEvents();
-            continue;
+            renderer.Retire(replaced);
+            renderer.Retire(spriteMaterial);
+            spriteMaterial = CreateSpriteMaterial(renderer._device, assets, spriteMaterial->_pipeline, frameBuffers);
+            assets.AddMaterial("mat_sprites", spriteMaterial);
         }
 
-        vk::DeviceSize offsets[] = {0};
+        if (auto replaced = frameBuffers.objects->Reserve(sizeof(ObjectInstance) * objectInstances.size()))
+        {
+            renderer.Retire(replaced);
+            renderer.Retire(objectMaterial);
+            objectMaterial = CreateObjectMaterial(renderer._device, assets, objectMaterial->_pipeline, frameBuffers);
+            assets.AddMaterial("mat_object", objectMaterial);
+        }
+
+        // Begin waited for this frame's previous use, its regions are free to write.
+        const auto frame = renderer.GetFrameIndex();
+        frameBuffers.constants->BeginFrame(frame);
+        frameBuffers.sprites->BeginFrame(frame);
+        frameBuffers.objects->BeginFrame(frame);
 
-        // Draw map
-        consts.mvp = proj * view * glm::scale(glm::mat4{1.0f}, glm::vec3{10.0f}) * glm::translate(glm::mat4{1.0f}, glm::vec3{0.5, 0.0f, 0.5f});
-        renderer.DrawMesh(level->_mapMesh, mapMaterial, &consts, sizeof(FrameConstants));
+        const auto constantsOffset = frameBuffers.constants->Push(&constsUbo, sizeof(FrameConstantsUBO));
+        const auto spritesOffset = frameBuffers.sprites->Push(sprites);
+        const auto objectsOffset = frameBuffers.objects->Push(objectInstances);
+
+        vk::DeviceSize offsets[] = {0};
 
-        // Draw floor
+        // Opaque geometry goes through the render queue, the map chunks share their buffers and batch into one draw.
         consts.mvp = proj * view * glm::scale(glm::mat4{1.0f}, glm::vec3{10.0f});
-        renderer.DrawMesh(level->_floorMesh, groundMaterial, &consts, sizeof(FrameConstants));
+        for (auto& chunk : level._mapMesh.GetChunks())
+            renderer.QueueMesh(chunk, mapMaterial, &consts, sizeof(FrameConstants));
 
-        // Draw doors
-        auto rendeables = registry.view<Game::Transform, Game::Renderable>();
-        for (auto [entity, xform, renderable] : rendeables.each())
-        {
-            ObjectPushConstants opc{
-                proj * view * glm::translate(glm::mat4{1.0f}, xform.position) * glm::scale(glm::mat4{1.0f}, xform.scale),
-                (float)renderable.tileIndex};
+        renderer.QueueMesh(level._floorMesh, groundMaterial, &consts, sizeof(FrameConstants));
 
-            renderer.DrawMesh(cubeMesh, objectMaterial, &opc, sizeof(ObjectPushConstants));
-        }
+        // Doors
+        ObjectPushConstants opc{proj * view};
+        renderer.QueueMesh(cubeMesh, objectMaterial, &opc, sizeof(ObjectPushConstants), (uint32_t)objectInstances.size(), {objectsOffset});
+
+        renderer.FlushQueue();
 
         // Draw sprites
-        renderer.Draw(6, (uint32_t)spriteModelMats.size(), spriteMaterial, nullptr, 0);
+        renderer.Draw(6, (uint32_t)sprites.size(), spriteMaterial, nullptr, 0, {constantsOffset, spritesOffset});
 
         // Hud
         auto orthoMat = glm::ortho(0.0f, (float)renderer._swapchain->GetExtent().width, (float)renderer._swapchain->GetExtent().height, 0.0f);
@@ -263,22 +434,126 @@ int main(int argc, char* argv[])
         int kk = 426;
         int gt = 431;
         int current = 0;
-        if (level->_currentWeapon == Game::Level::Weapon::Knife)
+        if (snapshot.weapon == Game::Level::Weapon::Knife)
             current = knife;
-        if (level->_currentWeapon == Game::Level::Weapon::Pistol)
+        if (snapshot.weapon == Game::Level::Weapon::Pistol)
             current = pistol;
-        if (level->_currentWeapon == Game::Level::Weapon::MachineGun)
+        if (snapshot.weapon == Game::Level::Weapon::MachineGun)
             current = kk;
-        if (level->_currentWeapon == Game::Level::Weapon::Gatling)
+        if (snapshot.weapon == Game::Level::Weapon::Gatling)
             current = gt;
         glm::vec2 weaponSize{size, size};
 
-        HudPushConstants hudPushConstants{orthoMat, weaponSize, {screenWidth / 2.0f, (screenHeight - size / 2.0f) + (size / 4.0) * level->_weaponChangeOffset}, 
-            current + level->_weaponFrameOffset };
+        HudPushConstants hudPushConstants{orthoMat, weaponSize, {screenWidth / 2.0f, (screenHeight - size / 2.0f) + (size / 4.0) * snapshot.weaponChangeOffset}, 
+            current + snapshot.weaponFrameOffset };
         renderer.Draw(6, 1, hudMaterial, &hudPushConstants, sizeof(HudPushConstants));
 
         renderer.End();
+        return true;
+    };
+
+    App::TripleBuffer<RenderSnapshot> snapshots;
+
+    std::atomic<bool> quitRendering{false};
+    std::thread renderThread;
+    if (pipelined)
+    {
+        renderThread = std::thread([&]() {
+            while (!quitRendering)
+            {
+                snapshots.Acquire();
+
+                // Nothing simulated yet, or nothing to draw to (window hidden, swapchain borked, etc.).
+                const auto& snapshot = snapshots.GetFront();
+                if (snapshot.level == nullptr || !renderSnapshot(snapshot))
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            }
+        });
     }
 
+    double prevTime = elapsed();
+    double tickAccumulator{};
+    auto& input = App::Input::The();
+    while (!glfwWindowShouldClose(window->Get()))
+    {
+        glfwPollEvents();
+
+        const auto nowTime = elapsed();
+        const auto delta = nowTime - prevTime;
+        prevTime = nowTime;
+
+        tickAccumulator += glm::min(delta, MaxTicksPerFrame * TickTime);
+
+        int ticks = 0;
+        bool levelChanged = false;
+        while (tickAccumulator >= TickTime && !levelChanged)
+        {
+            tickAccumulator -= TickTime;
+            level->Update(TickTime);
+            ticks++;
+
+            // Taps stay set until a tick has seen them.
+            input.Update();
+
+            if (level->GetState() == Game::Level::LevelState::GoToNextLevel)
+            {
+                // todo, handle return from secret level (to back to proper level order)
+                levelIndex++;
+                changeLevel((levelIndex / 10) + 1, (levelIndex % 10) + 1);
+                levelChanged = true;
+            }
+            else if (level->GetState() == Game::Level::LevelState::GoToSecretLevel)
+            {
+                changeLevel((levelIndex / 10) + 1, 10);
+                levelChanged = true;
+            }
+        }
+
+        if (levelChanged)
+        {
+            tickAccumulator = 0.0;
+            continue;
+        }
+
+        if (auto elevator = level->GetNearbyElevator(LevelPrefetchRange))
+        {
+            if (elevator->type == Game::Elevator::Type::Normal)
+                prefetchLevel(((levelIndex + 1) / 10) + 1, ((levelIndex + 1) % 10) + 1);
+            else
+                prefetchLevel((levelIndex / 10) + 1, 10);
+        }
+
+        if (ticks > 0)
+        {
+            CaptureSnapshot(level, nowTime - tickAccumulator, input.GetMousePos(), snapshots.GetBack());
+            snapshots.Publish();
+        }
+
+        if (pipelined)
+        {
+            // The render thread draws on its own, wait for the next tick.
+            std::this_thread::sleep_for(std::chrono::duration<double>(TickTime - tickAccumulator));
+            continue;
+        }
+
+        snapshots.Acquire();
+        const auto& snapshot = snapshots.GetFront();
+        if (snapshot.level != nullptr && !renderSnapshot(snapshot))
+        {
+            // Couldn't begin rendering (window hidden, swapchain borked, etc.), try again later.
+            glfwWaitEvents();
+        }
+    }
+
+    if (renderThread.joinable())
+    {
+        quitRendering = true;
+        renderThread.join();
+    }
+
+    // The loader job uses the renderer and loaders.
+    if (prefetch.level.valid())
+        prefetch.level.wait();
+
     return 0;
 }
@@ -6,8 +6,8 @@
 namespace Rendering
 {
 
-Buffer::Buffer(std::shared_ptr<Device> device, vk::Buffer buffer, VmaAllocation allocation, size_t size)
-    : _device(device), _buffer(buffer), _allocation(allocation), _size(size)
+Buffer::Buffer(std::shared_ptr<Device> device, vk::Buffer buffer, VmaAllocation allocation, size_t size, void* mapping)
+    : _device(device), _buffer(buffer), _allocation(allocation), _size(size), _mapping(mapping)
 {
 }
 
@@ -41,7 +41,10 @@ std::shared_ptr<Buffer> Buffer::CreateStagingBuffer(std::shared_ptr<Device> devi
 
 std::shared_ptr<Buffer> Buffer::CreateGPUBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t size)
 {
-    const vk::BufferCreateInfo bufferCreateInfo{{}, size, vk::BufferUsageFlagBits::eTransferDst | usage};
+    // Written on the transfer queue and read on the graphics queue.
+    const auto& queueFamilies = device->GetQueueFamilies();
+    const auto sharingMode = queueFamilies.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+    const vk::BufferCreateInfo bufferCreateInfo{{}, size, vk::BufferUsageFlagBits::eTransferDst | usage, sharingMode, queueFamilies};
 
     VmaAllocationCreateInfo allocInfo{};
     allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
@@ -56,36 +59,41 @@ std::shared_ptr<Buffer> Buffer::CreateGPUBuffer(std::shared_ptr<Device> device,
 
 std::shared_ptr<Buffer> Buffer::CreateUniformBuffer(std::shared_ptr<Device> device, size_t size)
 {
-    const vk::BufferCreateInfo bufferCreateInfo{{}, size, vk::BufferUsageFlagBits::eUniformBuffer};
-
-    VmaAllocationCreateInfo allocInfo{};
-    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-
-    vk::Buffer buffer{};
-    VmaAllocation allocation{};
+    return CreateMappedBuffer(device, vk::BufferUsageFlagBits::eUniformBuffer, size);
+}
 
-    vmaCreateBuffer(device->GetAllocator(), (VkBufferCreateInfo*)&bufferCreateInfo, &allocInfo, (VkBuffer*)&buffer, &allocation, nullptr);
+std::shared_ptr<Buffer> Buffer::CreateStorageBuffer(std::shared_ptr<Device> device, size_t size)
+{
+    return CreateMappedBuffer(device, vk::BufferUsageFlagBits::eStorageBuffer, size);
+}
 
-    return std::make_shared<Buffer>(device, buffer, allocation, size);
+std::shared_ptr<Buffer> Buffer::CreateIndirectBuffer(std::shared_ptr<Device> device, size_t size)
+{
+    return CreateMappedBuffer(device, vk::BufferUsageFlagBits::eIndirectBuffer, size);
 }
 
-std::shared_ptr<Buffer> Buffer::CreateStorageBuffer(std::shared_ptr<Device> device, size_t size)
+std::shared_ptr<Buffer> Buffer::CreateMappedBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t size)
 {
-    const vk::BufferCreateInfo bufferCreateInfo{{}, size, vk::BufferUsageFlagBits::eStorageBuffer};
+    const vk::BufferCreateInfo bufferCreateInfo{{}, size, usage};
 
     VmaAllocationCreateInfo allocInfo{};
+    allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
     allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 
     vk::Buffer buffer{};
     VmaAllocation allocation{};
+    VmaAllocationInfo allocationInfo{};
 
-    vmaCreateBuffer(device->GetAllocator(), (VkBufferCreateInfo*)&bufferCreateInfo, &allocInfo, (VkBuffer*)&buffer, &allocation, nullptr);
+    vmaCreateBuffer(device->GetAllocator(), (VkBufferCreateInfo*)&bufferCreateInfo, &allocInfo, (VkBuffer*)&buffer, &allocation, &allocationInfo);
 
-    return std::make_shared<Buffer>(device, buffer, allocation, size);
+    return std::make_shared<Buffer>(device, buffer, allocation, size, allocationInfo.pMappedData);
 }
 
 void* Buffer::Map()
 {
+    if (_mapping)
+        return _mapping;
+
     void* mapping = nullptr;
     vmaMapMemory(_device->GetAllocator(), _allocation, &mapping);
     return mapping;
@@ -93,23 +101,28 @@ void* Buffer::Map()
 
 void Buffer::UnMap()
 {
+    if (_mapping)
+        return;
+
     vmaUnmapMemory(_device->GetAllocator(), _allocation);
 }
 
 void Buffer::CopyTo(std::shared_ptr<Buffer> targetBuffer)
 {
-    _device->RunCommandsSync([&](vk::CommandBuffer cmdBuffer) {
-        vk::BufferCopy bufferCopy{0, 0, _size};
-        cmdBuffer.copyBuffer(_buffer, targetBuffer->Get(), 1, &bufferCopy);
-    });
+    UploadTo(targetBuffer, {vk::BufferCopy{0, 0, _size}});
 }
 
-void Buffer::SetData(void* data, size_t size)
+void Buffer::UploadTo(std::shared_ptr<Buffer> targetBuffer, const std::vector<vk::BufferCopy>& regions)
 {
-    void* mapping = nullptr;
-    vmaMapMemory(_device->GetAllocator(), _allocation, &mapping);
-    std::memcpy(mapping, data, size);
-    vmaUnmapMemory(_device->GetAllocator(), _allocation);
+    _device->GetUploads().Record([&](vk::CommandBuffer cmdBuffer) {
+        cmdBuffer.copyBuffer(_buffer, targetBuffer->Get(), regions);
+    }, {shared_from_this(), targetBuffer});
+}
+
+void Buffer::SetData(void* data, size_t size, size_t offset)
+{
+    std::memcpy((uint8_t*)Map() + offset, data, size);
+    UnMap();
 }
 
 } // namespace Rendering
\ No newline at end of file
@@ -6,29 +6,37 @@ namespace Rendering
 {
 class Device;
 
-class Buffer
+class Buffer : public std::enable_shared_from_this<Buffer>
 {
   public:
     static std::shared_ptr<Buffer> CreateStagingBuffer(std::shared_ptr<Device> device, void* data, size_t size);
     static std::shared_ptr<Buffer> CreateGPUBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t size);
     static std::shared_ptr<Buffer> CreateUniformBuffer(std::shared_ptr<Device> device, size_t size);
     static std::shared_ptr<Buffer> CreateStorageBuffer(std::shared_ptr<Device> device, size_t size);
+    static std::shared_ptr<Buffer> CreateIndirectBuffer(std::shared_ptr<Device> device, size_t size);
+    // Host visible buffer that stays mapped for its whole lifetime.
+    static std::shared_ptr<Buffer> CreateMappedBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t size);
 
-    Buffer(std::shared_ptr<Device> device, vk::Buffer buffer, VmaAllocation allocation, size_t size);
+    Buffer(std::shared_ptr<Device> device, vk::Buffer buffer, VmaAllocation allocation, size_t size, void* mapping = nullptr);
     ~Buffer();
 
     vk::Buffer Get() const { return _buffer; }
     size_t GetSize() const { return _size; }
+    // Persistently mapped buffers hand out their mapping, UnMap does nothing for them.
     void* Map();
     void UnMap();
 
+    // Recorded into the current upload batch, the target is ready for the first frame submitted afterwards.
     void CopyTo(std::shared_ptr<Buffer> targetBuffer);
-    void SetData(void* data, size_t size);
+    // Same for a target no frame has drawn from yet, buffers in use are updated through Renderer::CopyBuffer.
+    void UploadTo(std::shared_ptr<Buffer> targetBuffer, const std::vector<vk::BufferCopy>& regions);
+    void SetData(void* data, size_t size, size_t offset = 0);
 
   private:
     std::shared_ptr<Device> _device;
     vk::Buffer _buffer{};
     VmaAllocation _allocation{};
     size_t _size{};
+    void* _mapping{nullptr};
 };
 } // namespace Rendering
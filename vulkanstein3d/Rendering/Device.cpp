@@ -12,33 +12,25 @@ static const std::vector<const char*> requiredDeviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_KHR_MAINTENANCE1_EXTENSION_NAME,
     VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME};
 
-Device::Device(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue graphicsQueue, VmaAllocator allocator)
-    : _physicalDevice(physicalDevice), _device(device), _graphicsQueue(graphicsQueue), _allocator(allocator)
+Device::Device(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue graphicsQueue, uint32_t graphicsQueueFamily, vk::Queue transferQueue, uint32_t transferQueueFamily,
+               VmaAllocator allocator, const vk::PhysicalDeviceFeatures& enabledFeatures)
+    : _physicalDevice(physicalDevice), _device(device), _graphicsQueue(graphicsQueue), _graphicsQueueFamily(graphicsQueueFamily), _allocator(allocator), _enabledFeatures(enabledFeatures)
 {
+    _limits = _physicalDevice.getProperties().limits;
+
+    _queueFamilies.push_back(graphicsQueueFamily);
+    if (transferQueueFamily != graphicsQueueFamily)
+        _queueFamilies.push_back(transferQueueFamily);
+
+    _uploads = std::make_unique<UploadManager>(_device, transferQueue, transferQueueFamily);
 }
 
 Device::~Device()
 {
+    _uploads.reset();
     _device.destroy();
 }
 
-void Device::RunCommandsSync(std::function<void(vk::CommandBuffer)> func)
-{
-    auto commandPool = _device.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer}).value;
-    auto commandBuffer = _device.allocateCommandBuffers({commandPool, vk::CommandBufferLevel::ePrimary, 1}).value.front();
-
-    commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-    func(commandBuffer);
-    commandBuffer.end();
-
-    const vk::CommandBufferSubmitInfoKHR cmdBufferSubmit{commandBuffer};
-    const vk::SubmitInfo2KHR submitInfo{{}, 0, nullptr, 1, &cmdBufferSubmit, 0, nullptr};
-    _graphicsQueue.submit2KHR(1, &submitInfo, {});
-    _graphicsQueue.waitIdle();
-
-    _device.destroyCommandPool(commandPool);
-}
-
 static bool ValidateRequirements(vk::PhysicalDevice physicalDevice)
 {
     const auto [result, extensions] = physicalDevice.enumerateDeviceExtensionProperties();
@@ -103,14 +95,29 @@ std::shared_ptr<Device> Device::CreateDevice(std::shared_ptr<Instance> instance)
         }
     }
 
+    // Uploads go to a transfer only family when there is one, so they run alongside rendering.
+    uint32_t transferQueueIndex = graphicsQueueIndex;
+    for (auto i = 0; i < queues.size(); i++)
+    {
+        if ((queues[i].queueFlags & vk::QueueFlagBits::eTransfer) && !(queues[i].queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+        {
+            transferQueueIndex = i;
+            break;
+        }
+    }
+
     std::vector queuePriorities{1.0f};
     std::vector deviceQueueInfos{vk::DeviceQueueCreateInfo{{}, graphicsQueueIndex, queuePriorities}};
+    if (transferQueueIndex != graphicsQueueIndex)
+        deviceQueueInfos.push_back(vk::DeviceQueueCreateInfo{{}, transferQueueIndex, queuePriorities});
 
+    vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
     vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
     vk::PhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
     vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeaturesKHR{};
     vk::PhysicalDeviceFeatures2 physicalDeviceFeatures2{};
 
+    dynamicRenderingFeaturesKHR.setPNext(&timelineSemaphoreFeatures);
     descriptorIndexingFeatures.setPNext(&dynamicRenderingFeaturesKHR);
     synchronization2Features.setPNext(&descriptorIndexingFeatures);
     physicalDeviceFeatures2.setPNext(&synchronization2Features);
@@ -119,8 +126,14 @@ std::shared_ptr<Device> Device::CreateDevice(std::shared_ptr<Instance> instance)
 
     synchronization2Features.setSynchronization2(true);
     dynamicRenderingFeaturesKHR.setDynamicRendering(true);
+    timelineSemaphoreFeatures.setTimelineSemaphore(true);
 
-    vk::DeviceCreateInfo deviceCreateInfo{{}, deviceQueueInfos, {}, requiredDeviceExtensions, {}};
+    // Optional core features, enabled when the device has them.
+    vk::PhysicalDeviceFeatures enabledFeatures{};
+    enabledFeatures.setTextureCompressionBC(physicalDeviceFeatures2.features.textureCompressionBC);
+    enabledFeatures.setMultiDrawIndirect(physicalDeviceFeatures2.features.multiDrawIndirect);
+
+    vk::DeviceCreateInfo deviceCreateInfo{{}, deviceQueueInfos, {}, requiredDeviceExtensions, &enabledFeatures};
     deviceCreateInfo.setPNext(&synchronization2Features);
 
     const auto [deviceResult, device] = physicalDevice.createDevice(deviceCreateInfo);
@@ -132,6 +145,10 @@ std::shared_ptr<Device> Device::CreateDevice(std::shared_ptr<Instance> instance)
     }
 
     auto graphicsQueue = device.getQueue(graphicsQueueIndex, 0);
+    auto transferQueue = device.getQueue(transferQueueIndex, 0);
+
+    if (transferQueueIndex != graphicsQueueIndex)
+        spdlog::debug("[Vulkan] Using transfer queue family {}", transferQueueIndex);
 
     VmaAllocatorCreateInfo allocatorInfo{};
     allocatorInfo.physicalDevice = physicalDevice;
@@ -140,7 +157,7 @@ std::shared_ptr<Device> Device::CreateDevice(std::shared_ptr<Instance> instance)
     VmaAllocator allocator{};
     vmaCreateAllocator(&allocatorInfo, &allocator);
 
-    return std::make_shared<Device>(physicalDevice, device, graphicsQueue, allocator);
+    return std::make_shared<Device>(physicalDevice, device, graphicsQueue, graphicsQueueIndex, transferQueue, transferQueueIndex, allocator, enabledFeatures);
 }
 
 } // namespace Rendering
\ No newline at end of file
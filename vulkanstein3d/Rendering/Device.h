@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Instance.h"
+#include "UploadManager.h"
 
 namespace Rendering
 {
@@ -9,20 +10,29 @@ class Device
   public:
     static std::shared_ptr<Device> CreateDevice(std::shared_ptr<Instance> instance);
 
-    Device(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue graphicsQueue, VmaAllocator allocator);
+    Device(vk::PhysicalDevice physicalDevice, vk::Device device, vk::Queue graphicsQueue, uint32_t graphicsQueueFamily, vk::Queue transferQueue, uint32_t transferQueueFamily,
+           VmaAllocator allocator, const vk::PhysicalDeviceFeatures& enabledFeatures);
     ~Device();
 
     vk::Device Get() const { return _device; }
     vk::PhysicalDevice GetPhysicalDevice() const { return _physicalDevice; }
     vk::Queue GetGraphicQueue() const { return _graphicsQueue; }
     VmaAllocator GetAllocator() const { return _allocator; }
-
-    void RunCommandsSync(std::function<void(vk::CommandBuffer)> func);
+    const vk::PhysicalDeviceFeatures& GetEnabledFeatures() const { return _enabledFeatures; }
+    const vk::PhysicalDeviceLimits& GetLimits() const { return _limits; }
+    // Families whose queues access resources, shared resources are created concurrent between them.
+    const std::vector<uint32_t>& GetQueueFamilies() const { return _queueFamilies; }
+    UploadManager& GetUploads() { return *_uploads; }
 
   private:
     vk::PhysicalDevice _physicalDevice{};
     vk::Device _device{};
     vk::Queue _graphicsQueue{};
+    uint32_t _graphicsQueueFamily{};
+    std::vector<uint32_t> _queueFamilies;
     VmaAllocator _allocator{};
+    vk::PhysicalDeviceFeatures _enabledFeatures{};
+    vk::PhysicalDeviceLimits _limits{};
+    std::unique_ptr<UploadManager> _uploads;
 };
 } // namespace Rendering
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "../Common.h"
+
+#include "Buffer.h"
+#include "Device.h"
+#include "DynamicBuffer.h"
+
+namespace Rendering
+{
+static size_t AlignUp(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+std::shared_ptr<DynamicBuffer> DynamicBuffer::CreateDynamicBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t range, size_t frameSize, uint32_t framesInFlight)
+{
+    return std::make_shared<DynamicBuffer>(device, usage, range, frameSize, framesInFlight);
+}
+
+DynamicBuffer::DynamicBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t range, size_t frameSize, uint32_t framesInFlight)
+    : _device(device), _usage(usage), _framesInFlight(framesInFlight)
+{
+    const auto& limits = device->GetLimits();
+    _alignment = (usage & vk::BufferUsageFlagBits::eUniformBuffer) ? limits.minUniformBufferOffsetAlignment : limits.minStorageBufferOffsetAlignment;
+
+    Allocate(range, frameSize);
+}
+
+void DynamicBuffer::Allocate(size_t range, size_t frameSize)
+{
+    _range = range;
+    _frameSize = AlignUp(std::max(frameSize, range), _alignment);
+
+    // The range read from the last push of the last frame may run past its region, the tail keeps it inside the buffer.
+    _buffer = Buffer::CreateMappedBuffer(_device, _usage, _frameSize * _framesInFlight + _range);
+    _mapping = (uint8_t*)_buffer->Map();
+}
+
+std::shared_ptr<Buffer> DynamicBuffer::Reserve(size_t range)
+{
+    if (range <= _range)
+        return nullptr;
+
+    auto replaced = _buffer;
+    const auto grownRange = std::max(range, _range * 2);
+    Allocate(grownRange, std::max(_frameSize * 2, grownRange));
+
+    spdlog::debug("[Vulkan] DynamicBuffer grown to {} bytes per frame", _frameSize);
+    return replaced;
+}
+
+void DynamicBuffer::BeginFrame(uint32_t frameIndex)
+{
+    _frameStart = frameIndex * _frameSize;
+    _offset = _frameStart;
+}
+
+uint32_t DynamicBuffer::Push(const void* data, size_t size)
+{
+    if (size > _range || _offset + size > _frameStart + _frameSize)
+    {
+        spdlog::error("[Vulkan] DynamicBuffer: {} bytes don't fit the frame", size);
+        return (uint32_t)_frameStart;
+    }
+
+    const auto offset = _offset;
+    std::memcpy(_mapping + offset, data, size);
+
+    _offset = AlignUp(offset + size, _alignment);
+    return (uint32_t)offset;
+}
+} // namespace Rendering
\ No newline at end of file
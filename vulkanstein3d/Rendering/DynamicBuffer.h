@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../Common.h"
+
+#include <vector>
+
+namespace Rendering
+{
+class Buffer;
+class Device;
+
+// Linear allocator over a persistently mapped buffer with one region per frame in flight. Data pushed during
+// a frame is bound through a dynamic offset, so one descriptor set serves every frame.
+class DynamicBuffer
+{
+  public:
+    // range is how much a descriptor sees from each offset, frameSize how much can be pushed per frame.
+    static std::shared_ptr<DynamicBuffer> CreateDynamicBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t range, size_t frameSize, uint32_t framesInFlight);
+
+    DynamicBuffer(std::shared_ptr<Device> device, vk::BufferUsageFlags usage, size_t range, size_t frameSize, uint32_t framesInFlight);
+
+    std::shared_ptr<Buffer> GetBuffer() const { return _buffer; }
+    size_t GetRange() const { return _range; }
+
+    // Grows the buffer geometrically when a push of range bytes wouldn't fit. Returns the replaced buffer, which frames
+    // in flight may still read, and materials bound to this buffer have to be rebuilt. Call before BeginFrame.
+    std::shared_ptr<Buffer> Reserve(size_t range);
+
+    // Rewinds to the region of the given frame, only call once its previous use has finished on the GPU.
+    void BeginFrame(uint32_t frameIndex);
+
+    // Copies the data into the current frame and returns its dynamic offset.
+    uint32_t Push(const void* data, size_t size);
+
+    template <typename T>
+    uint32_t Push(const std::vector<T>& data)
+    {
+        return Push(data.data(), data.size() * sizeof(T));
+    }
+
+  private:
+    void Allocate(size_t range, size_t frameSize);
+
+  private:
+    std::shared_ptr<Device> _device;
+    vk::BufferUsageFlags _usage;
+    uint32_t _framesInFlight{};
+
+    std::shared_ptr<Buffer> _buffer;
+    uint8_t* _mapping{nullptr};
+    size_t _range{};
+    size_t _frameSize{};
+    size_t _alignment{};
+
+    size_t _frameStart{};
+    size_t _offset{};
+};
+} // namespace Rendering
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "../Common.h"
 
 #include "Buffer.h"
+#include "DynamicBuffer.h"
 #include "MaterialBuilder.h"
 
 namespace Rendering
@@ -29,19 +30,30 @@ MaterialBuilder& MaterialBuilder::SetTexture(uint32_t binding, std::vector<std::
     return *this;
 }
 
-MaterialBuilder& MaterialBuilder::SetBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer)
+MaterialBuilder& MaterialBuilder::SetBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer, vk::DeviceSize offset, vk::DeviceSize range)
 {
-    _buffers[binding] = buffer;
+    _buffers[binding] = vk::DescriptorBufferInfo{buffer->Get(), offset, range};
     return *this;
 }
 
+MaterialBuilder& MaterialBuilder::SetBuffer(uint32_t binding, std::shared_ptr<DynamicBuffer> buffer)
+{
+    return SetBuffer(binding, buffer->GetBuffer(), 0, buffer->GetRange());
+}
+
 std::shared_ptr<Material> MaterialBuilder::Build(std::shared_ptr<Device> device)
 {
     // hack
     if (!_pipeline->descriptorSetLayout)
         return std::make_shared<Material>(_pipeline, vk::DescriptorSet{});
 
-    std::vector<vk::DescriptorPoolSize> descriptorPoolSizes = {{vk::DescriptorType::eCombinedImageSampler, 10}};
+    std::map<vk::DescriptorType, uint32_t> typeCounts{{vk::DescriptorType::eCombinedImageSampler, 10}};
+    for (const auto& [binding, type] : _pipeline->descriptorTypes)
+        typeCounts[type]++;
+
+    std::vector<vk::DescriptorPoolSize> descriptorPoolSizes;
+    for (const auto& [type, count] : typeCounts)
+        descriptorPoolSizes.push_back({type, count});
     auto descriptorPool = device->Get().createDescriptorPool({{}, 1, descriptorPoolSizes}).value;
 
     vk::DescriptorSetAllocateInfo descriptorSetAllocateInfo{descriptorPool, 1, &_pipeline->descriptorSetLayout};
@@ -72,13 +84,17 @@ std::shared_ptr<Material> MaterialBuilder::Build(std::shared_ptr<Device> device)
         device->Get().updateDescriptorSets(1, &write, 0, nullptr);
     }
 
-    int hack = 0;
-    for (const auto& [binding, buffer] : _buffers)
+    for (const auto& [binding, bufferInfo] : _buffers)
     {
-        vk::DescriptorBufferInfo bufferInfo{buffer->Get(), 0, VK_WHOLE_SIZE};
-        vk::WriteDescriptorSet write{descriptorSet, binding, 0, 1, hack == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer, {}, &bufferInfo, {}};
+        auto type = _pipeline->descriptorTypes.find(binding);
+        if (type == _pipeline->descriptorTypes.end())
+        {
+            spdlog::error("[Vulkan] Material buffer binding {} isn't used by the pipeline", binding);
+            continue;
+        }
+
+        vk::WriteDescriptorSet write{descriptorSet, binding, 0, 1, type->second, {}, &bufferInfo, {}};
         device->Get().updateDescriptorSets(1, &write, 0, nullptr);
-        hack++;
     }
 
     return std::make_shared<Material>(_pipeline, descriptorSet);
@@ -11,6 +11,7 @@
 namespace Rendering
 {
 class Buffer;
+class DynamicBuffer;
 
 class Material
 {
@@ -27,14 +28,16 @@ class MaterialBuilder
     MaterialBuilder& SetPipeline(std::shared_ptr<Pipeline> pipeline);
     MaterialBuilder& SetTexture(uint32_t binding, std::shared_ptr<Texture> texture);
     MaterialBuilder& SetTexture(uint32_t binding, std::vector<std::shared_ptr<Texture>> textures);
-    MaterialBuilder& SetBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer);
+    MaterialBuilder& SetBuffer(uint32_t binding, std::shared_ptr<Buffer> buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+    // The binding must be dynamic in the pipeline, draws pass the offset returned by DynamicBuffer::Push.
+    MaterialBuilder& SetBuffer(uint32_t binding, std::shared_ptr<DynamicBuffer> buffer);
 
     std::shared_ptr<Material> Build(std::shared_ptr<Device> device);
 
   private:
     std::shared_ptr<Device> _device;
     std::shared_ptr<Pipeline> _pipeline;
-    std::map<uint32_t, std::shared_ptr<Buffer>> _buffers;
+    std::map<uint32_t, vk::DescriptorBufferInfo> _buffers;
     std::map<uint32_t, std::shared_ptr<Texture>> _textures;
     std::map<uint32_t, std::vector<std::shared_ptr<Texture>>> _textureVariableCounts;
 };
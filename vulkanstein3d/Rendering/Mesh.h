@@ -11,13 +11,16 @@ class Mesh
     {
     }
 
-    Mesh(std::shared_ptr<Rendering::Buffer> vertexBuffer, std::shared_ptr<Rendering::Buffer> indexBuffer, uint32_t indexCount)
-        : _vertexBuffer(vertexBuffer), _indexBuffer(indexBuffer), _indexCount(indexCount)
+    Mesh(std::shared_ptr<Rendering::Buffer> vertexBuffer, std::shared_ptr<Rendering::Buffer> indexBuffer, uint32_t indexCount, uint32_t firstIndex = 0, int32_t vertexOffset = 0)
+        : _vertexBuffer(vertexBuffer), _indexBuffer(indexBuffer), _indexCount(indexCount), _firstIndex(firstIndex), _vertexOffset(vertexOffset)
     {
     }
 
     std::shared_ptr<Rendering::Buffer> _vertexBuffer;
     std::shared_ptr<Rendering::Buffer> _indexBuffer;
     uint32_t _indexCount{};
+    // Meshes can share buffers, these locate the mesh inside them.
+    uint32_t _firstIndex{};
+    int32_t _vertexOffset{};
 };
 } // namespace Rendering
\ No newline at end of file
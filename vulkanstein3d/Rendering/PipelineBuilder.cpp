@@ -31,6 +31,18 @@ PipelineBuilder& PipelineBuilder::SetRasterization(vk::CullModeFlags cullMode, v
     return *this;
 }
 
+PipelineBuilder& PipelineBuilder::SetVertexAttributeFormat(uint32_t location, vk::Format format)
+{
+    _vertexAttributeFormats[location] = format;
+    return *this;
+}
+
+PipelineBuilder& PipelineBuilder::SetDynamicBinding(uint32_t binding)
+{
+    _dynamicBindings.insert(binding);
+    return *this;
+}
+
 PipelineBuilder& PipelineBuilder::SetDepthState(bool depthTest, bool depthWrite)
 {
     _isDepthTest = depthTest;
@@ -145,7 +157,11 @@ std::shared_ptr<Pipeline> PipelineBuilder::Build(std::shared_ptr<Device> device)
     delete vertShader.reflectInfo;
     delete fragShader.reflectInfo;
 
-    return std::make_shared<Pipeline>(pipeline, _pipelineLayout, _descriptorLayout);
+    std::map<uint32_t, vk::DescriptorType> descriptorTypes;
+    for (const auto& binding : _setBindings[0])
+        descriptorTypes[binding.binding] = binding.descriptorType;
+
+    return std::make_shared<Pipeline>(pipeline, _pipelineLayout, _descriptorLayout, descriptorTypes);
 }
 
 void PipelineBuilder::ReflectVertexInput(Shader& shader)
@@ -167,6 +183,10 @@ void PipelineBuilder::ReflectVertexInput(Shader& shader)
             _vertexAttributes[i].binding = bindingDescription.binding;
             _vertexAttributes[i].format = static_cast<vk::Format>(inputVars[i]->format);
             _vertexAttributes[i].offset = 0; // final offset computed below after sorting.
+
+            auto format = _vertexAttributeFormats.find(inputVars[i]->location);
+            if (format != _vertexAttributeFormats.end())
+                _vertexAttributes[i].format = format->second;
         }
         // Sort attributes by location
         std::sort(std::begin(_vertexAttributes), std::end(_vertexAttributes),
@@ -179,13 +199,32 @@ void PipelineBuilder::ReflectVertexInput(Shader& shader)
             uint32_t formatSize = 0;
             switch (attribute.format)
             {
+            case vk::Format::eR8G8B8A8Unorm:
+            case vk::Format::eR8G8B8A8Snorm:
+            case vk::Format::eR8G8B8A8Uint:
+            case vk::Format::eR8G8B8A8Sint:
+            case vk::Format::eR32Sfloat:
+            case vk::Format::eR32Uint:
+            case vk::Format::eR32Sint:
+                formatSize = 4;
+                break;
+            case vk::Format::eR16G16B16A16Unorm:
+            case vk::Format::eR16G16B16A16Snorm:
+            case vk::Format::eR16G16B16A16Uint:
+            case vk::Format::eR16G16B16A16Sint:
             case vk::Format::eR32G32Sfloat:
+            case vk::Format::eR32G32Uint:
+            case vk::Format::eR32G32Sint:
                 formatSize = 8;
                 break;
             case vk::Format::eR32G32B32Sfloat:
+            case vk::Format::eR32G32B32Uint:
+            case vk::Format::eR32G32B32Sint:
                 formatSize = 12;
                 break;
             case vk::Format::eR32G32B32A32Sfloat:
+            case vk::Format::eR32G32B32A32Uint:
+            case vk::Format::eR32G32B32A32Sint:
                 formatSize = 16;
                 break;
             default:
@@ -224,6 +263,13 @@ void PipelineBuilder::ReflectLayout(Shader& shader)
             vk::DescriptorSetLayoutBinding layoutBinding{};
             layoutBinding.binding = refl_binding.binding;
             layoutBinding.descriptorType = static_cast<vk::DescriptorType>(refl_binding.descriptor_type);
+            if (refl_set.set == 0 && _dynamicBindings.contains(layoutBinding.binding))
+            {
+                if (layoutBinding.descriptorType == vk::DescriptorType::eUniformBuffer)
+                    layoutBinding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+                else if (layoutBinding.descriptorType == vk::DescriptorType::eStorageBuffer)
+                    layoutBinding.descriptorType = vk::DescriptorType::eStorageBufferDynamic;
+            }
             layoutBinding.descriptorCount = 1;
             for (uint32_t i_dim = 0; i_dim < refl_binding.array.dims_count; ++i_dim)
             {
@@ -3,6 +3,7 @@
 #include "Device.h"
 
 #include <map>
+#include <set>
 #include <string>
 
 struct SpvReflectShaderModule;
@@ -23,6 +24,7 @@ class Pipeline
     vk::Pipeline pipeline{};
     vk::PipelineLayout pipelineLayout{};
     vk::DescriptorSetLayout descriptorSetLayout{};
+    std::map<uint32_t, vk::DescriptorType> descriptorTypes; // set 0 bindings
 };
 
 class PipelineBuilder
@@ -35,6 +37,10 @@ class PipelineBuilder
     PipelineBuilder& SetBlend(bool enable);
     PipelineBuilder& SetDynamicState(const std::vector<vk::DynamicState>& dynamicState);
     PipelineBuilder& SetRasterization(vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack, vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise);
+    // Reflection only sees the shader side type, packed attributes need their buffer format set here.
+    PipelineBuilder& SetVertexAttributeFormat(uint32_t location, vk::Format format);
+    // Makes a set 0 uniform or storage buffer binding take a dynamic offset at bind time.
+    PipelineBuilder& SetDynamicBinding(uint32_t binding);
 
     std::shared_ptr<Pipeline> Build(std::shared_ptr<Device> device);
 
@@ -55,6 +61,8 @@ class PipelineBuilder
 
     std::vector<vk::VertexInputBindingDescription> _bindingDescriptions;
     std::vector<vk::VertexInputAttributeDescription> _vertexAttributes;
+    std::map<uint32_t, vk::Format> _vertexAttributeFormats;
+    std::set<uint32_t> _dynamicBindings;
     std::map<uint32_t, std::vector<vk::DescriptorSetLayoutBinding>> _setBindings;
     std::vector<vk::PushConstantRange> _pushConstants;
 
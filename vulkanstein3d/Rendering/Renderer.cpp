@@ -4,7 +4,7 @@
 
 namespace Rendering
 {
-Renderer::Renderer(std::shared_ptr<App::Window> window)
+Renderer::Renderer(std::shared_ptr<App::Window> window, uint32_t framesInFlight)
 {
     _instance = Rendering::Instance::CreateInstance(window);
     _device = Rendering::Device::CreateDevice(_instance);
@@ -13,25 +13,36 @@ Renderer::Renderer(std::shared_ptr<App::Window> window)
 
     auto dev = _device->Get();
 
-    _commandPool = dev.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer}).value;
-    _commandBuffer = dev.allocateCommandBuffers({_commandPool, vk::CommandBufferLevel::ePrimary, 1}).value.front();
+    _frames.resize(std::max(framesInFlight, 1u));
+    for (auto& frame : _frames)
+    {
+        frame.commandPool = dev.createCommandPool({vk::CommandPoolCreateFlagBits::eResetCommandBuffer}).value;
+        frame.commandBuffer = dev.allocateCommandBuffers({frame.commandPool, vk::CommandBufferLevel::ePrimary, 1}).value.front();
+
+        frame.renderFence = dev.createFence({vk::FenceCreateFlagBits::eSignaled}).value;
+        frame.presentSemaphore = dev.createSemaphore({}).value;
+    }
 
-    _renderFence = dev.createFence({vk::FenceCreateFlagBits::eSignaled}).value;
-    _presentSemaphore = dev.createSemaphore({}).value;
-    _renderSemaphore = dev.createSemaphore({}).value;
+    CreateRenderSemaphores();
 }
 
 Renderer::~Renderer()
 {
     auto dev = _device->Get();
 
+    _device->GetUploads().WaitIdle();
     auto idleResult = dev.waitIdle();
 
-    dev.destroySemaphore(_renderSemaphore);
-    dev.destroySemaphore(_presentSemaphore);
-    dev.destroyFence(_renderFence);
+    for (auto semaphore : _renderSemaphores)
+        dev.destroySemaphore(semaphore);
 
-    dev.destroyCommandPool(_commandPool);
+    for (auto& frame : _frames)
+    {
+        dev.destroySemaphore(frame.presentSemaphore);
+        dev.destroyFence(frame.renderFence);
+
+        dev.destroyCommandPool(frame.commandPool);
+    }
 }
 
 bool Renderer::Begin()
@@ -47,21 +58,37 @@ bool Renderer::Begin()
         }
 
         _recreateSwapchain = false;
+        CreateRenderSemaphores();
         _depthTexture = Rendering::Texture::CreateDepthTexture(_device, _swapchain->GetExtent().width, _swapchain->GetExtent().height);
     }
 
-    auto fenceResult = dev.waitForFences(1, &_renderFence, VK_TRUE, UINT64_MAX);
-    auto resetResult = dev.resetFences(1, &_renderFence);
+    // Only waits for the frame that last used this slot, the others keep rendering.
+    auto& frame = _frames[_frameIndex];
+    auto fenceResult = dev.waitForFences(1, &frame.renderFence, VK_TRUE, UINT64_MAX);
+    auto resetResult = dev.resetFences(1, &frame.renderFence);
 
-    _imageIndex = dev.acquireNextImageKHR(_swapchain->Get(), UINT64_MAX, _presentSemaphore).value;
+    // Fences signal in submit order, everything up to this frame's last submit is done.
+    while (!_retired.empty() && _retired.front().first <= frame.submitNumber)
+        _retired.pop_front();
+    frame.indirectOffset = 0;
 
+    _imageIndex = dev.acquireNextImageKHR(_swapchain->Get(), UINT64_MAX, frame.presentSemaphore).value;
+
+    _commandBuffer = frame.commandBuffer;
     _commandBuffer.reset({});
     auto beginResult = _commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+    _boundPipeline = vk::Pipeline{};
+    _boundDescriptorSet = vk::DescriptorSet{};
+    _boundVertexBuffer = vk::Buffer{};
+    _boundIndexBuffer = vk::Buffer{};
     if (beginResult != vk::Result::eSuccess)
     {
         spdlog::warn("[Vulkan] begin: {}", vk::to_string(beginResult));
     }
 
+    RecordCopies();
+
     // Swapchain image -> eColorAttachmentOptimal
     // Depth image -> eColorAttachmentOptimal
     std::vector<vk::ImageMemoryBarrier2KHR> attachmentBarriers(2);
@@ -90,6 +117,7 @@ bool Renderer::Begin()
 
 void Renderer::End()
 {
+    FlushQueue();
     EndRenderPass();
 
     // Swapchain image -> ePresentSrcKHR
@@ -113,6 +141,52 @@ void Renderer::End()
     Submit();
 }
 
+void Renderer::Retire(std::shared_ptr<void> resource)
+{
+    _retired.push_back({_submitCount + 1, std::move(resource)});
+}
+
+void Renderer::CreateRenderSemaphores()
+{
+    auto dev = _device->Get();
+
+    // The image count can change with the swapchain, nothing is in flight when this runs.
+    for (auto semaphore : _renderSemaphores)
+        dev.destroySemaphore(semaphore);
+
+    _renderSemaphores.resize(_swapchain->GetImages().size());
+    for (auto& semaphore : _renderSemaphores)
+        semaphore = dev.createSemaphore({}).value;
+}
+
+void Renderer::CopyBuffer(std::shared_ptr<Rendering::Buffer> source, std::shared_ptr<Rendering::Buffer> target, const std::vector<vk::BufferCopy>& regions)
+{
+    _pendingCopies.push_back({std::move(source), std::move(target), regions});
+}
+
+void Renderer::RecordCopies()
+{
+    if (_pendingCopies.empty())
+        return;
+
+    // Earlier frames on this queue finish reading vertices and indices before they're overwritten.
+    const vk::MemoryBarrier2KHR readsDone{vk::PipelineStageFlagBits2KHR::eVertexInput, vk::AccessFlagBits2KHR::eNone,
+                                          vk::PipelineStageFlagBits2KHR::eTransfer, vk::AccessFlagBits2KHR::eTransferWrite};
+    _commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR{{}, 1, &readsDone});
+
+    for (auto& copy : _pendingCopies)
+    {
+        _commandBuffer.copyBuffer(copy.source->Get(), copy.target->Get(), copy.regions);
+        Retire(std::move(copy.source));
+        Retire(std::move(copy.target));
+    }
+    _pendingCopies.clear();
+
+    const vk::MemoryBarrier2KHR writesDone{vk::PipelineStageFlagBits2KHR::eTransfer, vk::AccessFlagBits2KHR::eTransferWrite,
+                                           vk::PipelineStageFlagBits2KHR::eVertexInput, vk::AccessFlagBits2KHR::eVertexAttributeRead | vk::AccessFlagBits2KHR::eIndexRead};
+    _commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR{{}, 1, &writesDone});
+}
+
 void Renderer::BeginRenderPass()
 {
     vk::RenderingAttachmentInfoKHR colorAttachment{};
@@ -155,35 +229,43 @@ void Renderer::EndRenderPass()
 
 void Renderer::Submit()
 {
+    auto& frame = _frames[_frameIndex];
+
+    // Everything uploaded so far goes out with this frame, which waits for it on the GPU.
+    auto& uploads = _device->GetUploads();
+    const auto uploadValue = uploads.Flush();
+
     const vk::CommandBufferSubmitInfoKHR cmdBufferSubmit{_commandBuffer};
-    const vk::SemaphoreSubmitInfoKHR waitSemaphore{_presentSemaphore, 0, vk::PipelineStageFlagBits2KHR::eAllCommands, 0};
-    const vk::SemaphoreSubmitInfoKHR signalSemaphore{_renderSemaphore, 0, vk::PipelineStageFlagBits2KHR::eAllCommands, 0};
+    const std::array waitSemaphores{vk::SemaphoreSubmitInfoKHR{frame.presentSemaphore, 0, vk::PipelineStageFlagBits2KHR::eAllCommands, 0},
+                                    vk::SemaphoreSubmitInfoKHR{uploads.GetSemaphore(), uploadValue, vk::PipelineStageFlagBits2KHR::eAllCommands, 0}};
+    const vk::SemaphoreSubmitInfoKHR signalSemaphore{_renderSemaphores[_imageIndex], 0, vk::PipelineStageFlagBits2KHR::eAllCommands, 0};
 
-    const vk::SubmitInfo2KHR submitInfo{{}, 1, &waitSemaphore, 1, &cmdBufferSubmit, 1, &signalSemaphore};
+    const vk::SubmitInfo2KHR submitInfo{{}, (uint32_t)waitSemaphores.size(), waitSemaphores.data(), 1, &cmdBufferSubmit, 1, &signalSemaphore};
 
     auto graphicsQueue = _device->GetGraphicQueue();
-    auto submitResult = graphicsQueue.submit2KHR(1, &submitInfo, _renderFence);
+    auto submitResult = graphicsQueue.submit2KHR(1, &submitInfo, frame.renderFence);
+    frame.submitNumber = ++_submitCount;
     if (submitResult != vk::Result::eSuccess)
     {
         spdlog::warn("[Vulkan] submit2KHR: {}", vk::to_string(submitResult));
     }
 
     auto sc = _swapchain->Get();
-    const vk::PresentInfoKHR presentInfo{1, &_renderSemaphore, 1, &sc, &_imageIndex};
+    const vk::PresentInfoKHR presentInfo{1, &_renderSemaphores[_imageIndex], 1, &sc, &_imageIndex};
     auto presentResult = graphicsQueue.presentKHR(presentInfo);
     if (presentResult != vk::Result::eSuccess)
     {
         spdlog::warn("[Vulkan] presentKHR: {}", vk::to_string(presentResult));
         _recreateSwapchain = true;
     }
+
+    _frameIndex = (_frameIndex + 1) % (uint32_t)_frames.size();
 }
 
-void Renderer::Draw(uint32_t vertexCount, uint32_t instances, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize)
+void Renderer::Draw(uint32_t vertexCount, uint32_t instances, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize,
+                    const std::vector<uint32_t>& dynamicOffsets)
 {
-    _commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipeline);
-
-    if (material->_descriptorSet)
-        _commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipelineLayout, 0, 1, &material->_descriptorSet, 0, nullptr);
+    BindMaterial(material, dynamicOffsets);
 
     if (pushConstants)
         _commandBuffer.pushConstants(material->_pipeline->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, (uint32_t)pushConstantSize, pushConstants);
@@ -191,23 +273,145 @@ void Renderer::Draw(uint32_t vertexCount, uint32_t instances, std::shared_ptr<Re
     _commandBuffer.draw(vertexCount, instances, 0, 0);
 }
 
-void Renderer::DrawMesh(Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize)
+void Renderer::DrawMesh(Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize, uint32_t instances,
+                        const std::vector<uint32_t>& dynamicOffsets)
 {
-    vk::Buffer vertexBuffers[] = {mesh._vertexBuffer->Get()};
-    vk::DeviceSize offsets[] = {0};
+    BindMaterial(material, dynamicOffsets);
 
-    _commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipeline);
+    if (pushConstants)
+        _commandBuffer.pushConstants(material->_pipeline->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, (uint32_t)pushConstantSize, pushConstants);
+
+    BindMesh(mesh);
 
-    if (material->_descriptorSet)
-        _commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipelineLayout, 0, 1, &material->_descriptorSet, 0, nullptr);
+    _commandBuffer.drawIndexed(mesh._indexCount, instances, mesh._firstIndex, mesh._vertexOffset, 0);
+}
+
+void Renderer::QueueMesh(const Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize, uint32_t instances,
+                         const std::vector<uint32_t>& dynamicOffsets)
+{
+    if (mesh._indexCount == 0 || instances == 0)
+        return;
+
+    DrawPacket packet{mesh, material};
+    assert(pushConstantSize <= packet.pushConstants.size());
 
     if (pushConstants)
-        _commandBuffer.pushConstants(material->_pipeline->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, (uint32_t)pushConstantSize, pushConstants);
+    {
+        std::memcpy(packet.pushConstants.data(), pushConstants, pushConstantSize);
+        packet.pushConstantSize = (uint32_t)pushConstantSize;
+    }
+    packet.instances = instances;
+    packet.dynamicOffsets = dynamicOffsets;
 
-    _commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-    _commandBuffer.bindIndexBuffer(mesh._indexBuffer->Get(), 0, vk::IndexType::eUint32);
+    _queue.push_back(packet);
+}
 
-    _commandBuffer.drawIndexed(mesh._indexCount, 1, 0, 0, 0);
+void Renderer::FlushQueue()
+{
+    if (_queue.empty())
+        return;
+
+    auto sortKey = [](const DrawPacket& packet) {
+        return std::make_tuple(packet.material->_pipeline->pipeline, packet.material->_descriptorSet, std::cref(packet.dynamicOffsets), packet.mesh._vertexBuffer->Get(), packet.mesh._indexBuffer->Get());
+    };
+
+    std::stable_sort(_queue.begin(), _queue.end(), [&](const DrawPacket& a, const DrawPacket& b) { return sortKey(a) < sortKey(b); });
+
+    auto& frame = _frames[_frameIndex];
+
+    const size_t size = frame.indirectOffset + _queue.size() * sizeof(vk::DrawIndexedIndirectCommand);
+    if (!frame.indirectBuffer || frame.indirectBuffer->GetSize() < size)
+    {
+        if (frame.indirectBuffer)
+            Retire(frame.indirectBuffer);
+
+        // Commands recorded earlier this frame stay in the retired buffer, the new one starts empty.
+        frame.indirectOffset = 0;
+        frame.indirectBuffer = Rendering::Buffer::CreateIndirectBuffer(_device, std::max<size_t>(_queue.size() * sizeof(vk::DrawIndexedIndirectCommand) * 2, 4096));
+    }
+
+    auto commands = reinterpret_cast<vk::DrawIndexedIndirectCommand*>((uint8_t*)frame.indirectBuffer->Map() + frame.indirectOffset);
+    for (size_t i = 0; i < _queue.size(); i++)
+    {
+        const auto& mesh = _queue[i].mesh;
+        commands[i] = vk::DrawIndexedIndirectCommand{mesh._indexCount, _queue[i].instances, mesh._firstIndex, mesh._vertexOffset, 0};
+    }
+    frame.indirectBuffer->UnMap();
+
+    const bool multiDraw = _device->GetEnabledFeatures().multiDrawIndirect;
+    const uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+    size_t first = 0;
+    while (first < _queue.size())
+    {
+        const auto& packet = _queue[first];
+
+        size_t last = first + 1;
+        while (last < _queue.size() && sortKey(_queue[last]) == sortKey(packet) && _queue[last].pushConstantSize == packet.pushConstantSize &&
+               std::memcmp(_queue[last].pushConstants.data(), packet.pushConstants.data(), packet.pushConstantSize) == 0)
+            last++;
+
+        BindMaterial(packet.material, packet.dynamicOffsets);
+
+        if (packet.pushConstantSize > 0)
+            _commandBuffer.pushConstants(packet.material->_pipeline->pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, packet.pushConstantSize, packet.pushConstants.data());
+
+        BindMesh(packet.mesh);
+
+        const vk::DeviceSize offset = frame.indirectOffset + first * stride;
+        const auto count = (uint32_t)(last - first);
+        if (multiDraw)
+        {
+            _commandBuffer.drawIndexedIndirect(frame.indirectBuffer->Get(), offset, count, stride);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+                _commandBuffer.drawIndexedIndirect(frame.indirectBuffer->Get(), offset + i * stride, 1, stride);
+        }
+
+        first = last;
+    }
+
+    frame.indirectOffset += _queue.size() * stride;
+    _queue.clear();
+}
+
+void Renderer::BindMaterial(const std::shared_ptr<Rendering::Material>& material, const std::vector<uint32_t>& dynamicOffsets)
+{
+    if (_boundPipeline != material->_pipeline->pipeline)
+    {
+        _commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipeline);
+        _boundPipeline = material->_pipeline->pipeline;
+
+        // Sets bound with a different layout may have been disturbed.
+        _boundDescriptorSet = vk::DescriptorSet{};
+    }
+
+    if (material->_descriptorSet && (_boundDescriptorSet != material->_descriptorSet || _boundDynamicOffsets != dynamicOffsets))
+    {
+        _commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, material->_pipeline->pipelineLayout, 0, 1, &material->_descriptorSet,
+                                          (uint32_t)dynamicOffsets.size(), dynamicOffsets.data());
+        _boundDescriptorSet = material->_descriptorSet;
+        _boundDynamicOffsets = dynamicOffsets;
+    }
+}
+
+void Renderer::BindMesh(const Rendering::Mesh& mesh)
+{
+    if (_boundVertexBuffer != mesh._vertexBuffer->Get())
+    {
+        vk::Buffer vertexBuffers[] = {mesh._vertexBuffer->Get()};
+        vk::DeviceSize offsets[] = {0};
+        _commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+        _boundVertexBuffer = vertexBuffers[0];
+    }
+
+    if (_boundIndexBuffer != mesh._indexBuffer->Get())
+    {
+        _commandBuffer.bindIndexBuffer(mesh._indexBuffer->Get(), 0, vk::IndexType::eUint32);
+        _boundIndexBuffer = mesh._indexBuffer->Get();
+    }
 }
 
 } // namespace Rendering
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "Buffer.h"
 #include "Device.h"
+#include "DynamicBuffer.h"
 #include "Instance.h"
 #include "MaterialBuilder.h"
 #include "Mesh.h"
@@ -9,19 +10,40 @@
 #include "Swapchain.h"
 #include "Texture.h"
 
+#include <deque>
+
 namespace Rendering
 {
 class Renderer
 {
   public:
-    Renderer(std::shared_ptr<App::Window> window);
+    Renderer(std::shared_ptr<App::Window> window, uint32_t framesInFlight = 2);
     ~Renderer();
 
     bool Begin();
     void End();
 
-    void Draw(uint32_t vertexCount, uint32_t instances, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize);
-    void DrawMesh(Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize);
+    // The CPU records frame N + 1 while the GPU renders frame N. Per-frame data written by the caller
+    // should be kept once per frame in flight and picked with GetFrameIndex after Begin.
+    uint32_t GetFramesInFlight() const { return (uint32_t)_frames.size(); }
+    uint32_t GetFrameIndex() const { return _frameIndex; }
+    // Keeps the resource alive until every frame submitted so far, and the one being recorded, has finished.
+    void Retire(std::shared_ptr<void> resource);
+    // Recorded at the start of the next frame, before its draws and after earlier frames have read the target's vertices
+    // and indices. Both buffers stay alive until that frame has finished.
+    void CopyBuffer(std::shared_ptr<Rendering::Buffer> source, std::shared_ptr<Rendering::Buffer> target, const std::vector<vk::BufferCopy>& regions);
+
+    // dynamicOffsets go to the material's dynamic bindings in binding order.
+    void Draw(uint32_t vertexCount, uint32_t instances, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize,
+              const std::vector<uint32_t>& dynamicOffsets = {});
+    void DrawMesh(Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize, uint32_t instances = 1,
+                  const std::vector<uint32_t>& dynamicOffsets = {});
+
+    // Queued meshes are sorted by pipeline, material and mesh buffers. Neighbours that share all of them and their
+    // push constants go out as one indirect draw. Order between queued meshes isn't kept, flush before order dependent draws.
+    void QueueMesh(const Rendering::Mesh& mesh, std::shared_ptr<Rendering::Material> material, void* pushConstants, size_t pushConstantSize, uint32_t instances = 1,
+                   const std::vector<uint32_t>& dynamicOffsets = {});
+    void FlushQueue();
 
     std::shared_ptr<Rendering::Instance> _instance;
     std::shared_ptr<Rendering::Device> _device;
@@ -30,17 +52,63 @@ class Renderer
   private:
     std::shared_ptr<Rendering::Texture> _depthTexture;
 
-    vk::CommandPool _commandPool{};
-    vk::CommandBuffer _commandBuffer{};
+    struct Frame
+    {
+        vk::CommandPool commandPool{};
+        vk::CommandBuffer commandBuffer{};
+
+        vk::Fence renderFence{};
+        vk::Semaphore presentSemaphore{};
+
+        std::shared_ptr<Rendering::Buffer> indirectBuffer;
+        uint64_t submitNumber{}; // of the last submit that used this frame
+        size_t indirectOffset{};
+    };
 
-    vk::Fence _renderFence{};
-    vk::Semaphore _presentSemaphore{};
-    vk::Semaphore _renderSemaphore{};
+    std::vector<Frame> _frames;
+    uint32_t _frameIndex{0};
+    uint64_t _submitCount{0};
+    std::deque<std::pair<uint64_t, std::shared_ptr<void>>> _retired; // released once that submit has finished
+    vk::CommandBuffer _commandBuffer{}; // of the current frame
 
+    // Per swapchain image, a presentation holds on to its semaphore until that image is acquired again.
+    std::vector<vk::Semaphore> _renderSemaphores;
     uint32_t _imageIndex{0};
     bool _recreateSwapchain{false};
 
+    struct DrawPacket
+    {
+        Rendering::Mesh mesh;
+        std::shared_ptr<Rendering::Material> material;
+        std::array<uint8_t, 128> pushConstants{};
+        uint32_t pushConstantSize{};
+        uint32_t instances{};
+        std::vector<uint32_t> dynamicOffsets;
+    };
+
+    std::vector<DrawPacket> _queue;
+
+    struct PendingCopy
+    {
+        std::shared_ptr<Rendering::Buffer> source;
+        std::shared_ptr<Rendering::Buffer> target;
+        std::vector<vk::BufferCopy> regions;
+    };
+
+    std::vector<PendingCopy> _pendingCopies;
+
+    // Currently bound state of the command buffer, binds that wouldn't change it are skipped.
+    vk::Pipeline _boundPipeline{};
+    vk::DescriptorSet _boundDescriptorSet{};
+    std::vector<uint32_t> _boundDynamicOffsets;
+    vk::Buffer _boundVertexBuffer{};
+    vk::Buffer _boundIndexBuffer{};
+
   private:
+    void BindMaterial(const std::shared_ptr<Rendering::Material>& material, const std::vector<uint32_t>& dynamicOffsets);
+    void BindMesh(const Rendering::Mesh& mesh);
+    void RecordCopies();
+    void CreateRenderSemaphores();
     void BeginRenderPass();
     void EndRenderPass();
     void Submit();
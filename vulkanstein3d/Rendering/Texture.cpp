@@ -18,34 +18,65 @@ Texture::~Texture()
     vmaDestroyImage(_device->GetAllocator(), _image, _allocation);
 }
 
-std::shared_ptr<Texture> Texture::CreateTexture(std::shared_ptr<Device> device, void* data, uint32_t width, uint32_t height, uint32_t layers)
+uint32_t Texture::GetMipLevels(uint32_t width, uint32_t height)
 {
-    auto stagingBuffer = Buffer::CreateStagingBuffer(device, data, (width * height * 4) * layers);
-    return CreateTexture(device, stagingBuffer, width, height, layers);
+    uint32_t mipLevels = 1;
+    while ((width | height) >> mipLevels)
+        mipLevels++;
+
+    return mipLevels;
 }
 
-std::shared_ptr<Texture> Texture::CreateTexture(std::shared_ptr<Device> device, std::shared_ptr<Buffer> stagingBuffer, uint32_t width, uint32_t height, uint32_t layers)
+size_t Texture::GetImageSize(vk::Format format, uint32_t width, uint32_t height)
+{
+    switch (format)
+    {
+    case vk::Format::eR8Uint:
+        return width * height;
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbaUnormBlock:
+        return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+    default:
+        return width * height * 4;
+    }
+}
+
+std::shared_ptr<Texture> Texture::CreateTexture(std::shared_ptr<Device> device, void* data, uint32_t width, uint32_t height, uint32_t layers, vk::Format format, vk::SamplerAddressMode addressMode)
+{
+    auto stagingBuffer = Buffer::CreateStagingBuffer(device, data, GetImageSize(format, width, height) * layers);
+    return CreateTexture(device, stagingBuffer, width, height, layers, format, 1, addressMode);
+}
+
+std::shared_ptr<Texture> Texture::CreateTexture(std::shared_ptr<Device> device, std::shared_ptr<Buffer> stagingBuffer, uint32_t width, uint32_t height, uint32_t layers, vk::Format format, uint32_t mipLevels, vk::SamplerAddressMode addressMode)
 {
     vk::ImageCreateInfo imageCreateInfo{};
     imageCreateInfo.setImageType(vk::ImageType::e2D);
-    imageCreateInfo.setFormat(vk::Format::eR8G8B8A8Unorm);
+    imageCreateInfo.setFormat(format);
     imageCreateInfo.setExtent(vk::Extent3D(width, height, 1));
     imageCreateInfo.setArrayLayers(layers);
-    imageCreateInfo.setMipLevels(1);
+    imageCreateInfo.setMipLevels(mipLevels);
     imageCreateInfo.setSamples(vk::SampleCountFlagBits::e1);
     imageCreateInfo.setTiling(vk::ImageTiling::eOptimal);
     imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
 
+    // Uploaded on the transfer queue and sampled on the graphics queue.
+    const auto& queueFamilies = device->GetQueueFamilies();
+    if (queueFamilies.size() > 1)
+    {
+        imageCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+        imageCreateInfo.setQueueFamilyIndices(queueFamilies);
+    }
+
     vk::Image image{};
     VmaAllocation allocation{};
     VmaAllocationCreateInfo imageAllocInfo{};
     imageAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
     vmaCreateImage(device->GetAllocator(), (VkImageCreateInfo*)&imageCreateInfo, &imageAllocInfo, (VkImage*)&image, &allocation, nullptr);
 
-    device->RunCommandsSync([&](vk::CommandBuffer commandBuffer) {
+    device->GetUploads().Record([&](vk::CommandBuffer commandBuffer) {
         vk::ImageMemoryBarrier2KHR barrierToTransferDst{};
         barrierToTransferDst.setImage(image);
-        barrierToTransferDst.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers});
+        barrierToTransferDst.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, layers});
         barrierToTransferDst.setOldLayout(vk::ImageLayout::eUndefined);
         barrierToTransferDst.setNewLayout(vk::ImageLayout::eTransferDstOptimal);
         barrierToTransferDst.setSrcStageMask(vk::PipelineStageFlagBits2KHR::eNone);
@@ -57,38 +88,46 @@ std::shared_ptr<Texture> Texture::CreateTexture(std::shared_ptr<Device> device,
         std::vector<vk::BufferImageCopy> bufferCopyRegions;
         for (uint32_t layer = 0; layer < layers; layer++)
         {
-            uint32_t offset = static_cast<uint32_t>((stagingBuffer->GetSize() / layers) * layer);
-            vk::BufferImageCopy region{offset, 0, 0, vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, layer, 1}, vk::Offset3D{0, 0, 0}, vk::Extent3D{width, height, 1}};
-            bufferCopyRegions.push_back(region);
+            auto offset = (stagingBuffer->GetSize() / layers) * layer;
+            for (uint32_t mip = 0; mip < mipLevels; mip++)
+            {
+                const auto mipWidth = std::max(width >> mip, 1u);
+                const auto mipHeight = std::max(height >> mip, 1u);
+                vk::BufferImageCopy region{offset, 0, 0, vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, mip, layer, 1}, vk::Offset3D{0, 0, 0}, vk::Extent3D{mipWidth, mipHeight, 1}};
+                bufferCopyRegions.push_back(region);
+                offset += GetImageSize(format, mipWidth, mipHeight);
+            }
         }
         commandBuffer.copyBufferToImage(stagingBuffer->Get(), image, vk::ImageLayout::eTransferDstOptimal, bufferCopyRegions);
 
         vk::ImageMemoryBarrier2KHR barrierToShaderReadOnly{};
         barrierToShaderReadOnly.setImage(image);
-        barrierToShaderReadOnly.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers});
+        barrierToShaderReadOnly.setSubresourceRange(vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, layers});
         barrierToShaderReadOnly.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
         barrierToShaderReadOnly.setNewLayout(vk::ImageLayout::eReadOnlyOptimalKHR);
+        // Transfer queues have no shader stages, the renderer waiting on the upload semaphore makes the writes visible.
         barrierToShaderReadOnly.setSrcStageMask(vk::PipelineStageFlagBits2KHR::eTransfer);
-        barrierToShaderReadOnly.setDstStageMask(vk::PipelineStageFlagBits2KHR::eFragmentShader);
+        barrierToShaderReadOnly.setDstStageMask(vk::PipelineStageFlagBits2KHR::eNone);
         barrierToShaderReadOnly.setSrcAccessMask(vk::AccessFlagBits2KHR::eTransferWrite);
-        barrierToShaderReadOnly.setDstAccessMask(vk::AccessFlagBits2KHR::eShaderRead);
+        barrierToShaderReadOnly.setDstAccessMask(vk::AccessFlagBits2KHR::eNone);
 
         commandBuffer.pipelineBarrier2KHR(vk::DependencyInfoKHR{{}, 0, nullptr, 0, nullptr, 1, &barrierToShaderReadOnly});
-    });
+    }, {stagingBuffer});
 
-    const vk::ImageViewCreateInfo imageViewCreateInfo{{}, image, layers == 1 ? vk::ImageViewType::e2D : vk::ImageViewType::e2DArray, imageCreateInfo.format, {}, vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, layers}};
+    const vk::ImageViewCreateInfo imageViewCreateInfo{{}, image, layers == 1 ? vk::ImageViewType::e2D : vk::ImageViewType::e2DArray, imageCreateInfo.format, {}, vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, layers}};
 
     auto imageView = device->Get().createImageView(imageViewCreateInfo).value;
 
     vk::SamplerCreateInfo samplerCreateInfo{};
     samplerCreateInfo.setMagFilter(vk::Filter::eNearest);
     samplerCreateInfo.setMinFilter(vk::Filter::eNearest);
-    samplerCreateInfo.setMipmapMode(vk::SamplerMipmapMode::eLinear);
-    samplerCreateInfo.setAddressModeU(vk::SamplerAddressMode::eClampToEdge);
-    samplerCreateInfo.setAddressModeV(vk::SamplerAddressMode::eClampToEdge);
+    // Integer formats can't be filtered linearly.
+    samplerCreateInfo.setMipmapMode(format == vk::Format::eR8Uint ? vk::SamplerMipmapMode::eNearest : vk::SamplerMipmapMode::eLinear);
+    samplerCreateInfo.setAddressModeU(addressMode);
+    samplerCreateInfo.setAddressModeV(addressMode);
     samplerCreateInfo.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
     samplerCreateInfo.setMinLod(0.0f);
-    samplerCreateInfo.setMaxLod(1.0f);
+    samplerCreateInfo.setMaxLod((float)mipLevels);
     samplerCreateInfo.setMaxAnisotropy(1.0f);
 
     auto sampler = device->Get().createSampler(samplerCreateInfo).value;
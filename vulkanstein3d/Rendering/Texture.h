@@ -9,8 +9,11 @@ class Device;
 class Texture
 {
   public:
-    static std::shared_ptr<Texture> CreateTexture(std::shared_ptr<Device> device, void* data, uint32_t width, uint32_t height, uint32_t layers = 1);
-    static std::shared_ptr<Texture> CreateTexture(std::shared_ptr<Device> device, std::shared_ptr<Buffer> stagingBuffer, uint32_t width, uint32_t height, uint32_t layers = 1);
+    static std::shared_ptr<Texture> CreateTexture(std::shared_ptr<Device> device, void* data, uint32_t width, uint32_t height, uint32_t layers = 1, vk::Format format = vk::Format::eR8G8B8A8Unorm, vk::SamplerAddressMode addressMode = vk::SamplerAddressMode::eClampToEdge);
+    // The staging buffer holds each layer's full mip chain, largest mip first.
+    static std::shared_ptr<Texture> CreateTexture(std::shared_ptr<Device> device, std::shared_ptr<Buffer> stagingBuffer, uint32_t width, uint32_t height, uint32_t layers = 1, vk::Format format = vk::Format::eR8G8B8A8Unorm, uint32_t mipLevels = 1, vk::SamplerAddressMode addressMode = vk::SamplerAddressMode::eClampToEdge);
+    static uint32_t GetMipLevels(uint32_t width, uint32_t height);
+    static size_t GetImageSize(vk::Format format, uint32_t width, uint32_t height);
     static std::shared_ptr<Texture> CreateDepthTexture(std::shared_ptr<Device> device, uint32_t width, uint32_t height);
 
     Texture(std::shared_ptr<Device> device, vk::Image image, vk::ImageView imageView, vk::Sampler sampler, VmaAllocation allocation, vk::ImageViewType viewType);
@@ -0,0 +1,122 @@
+#include "../Common.h"
+
+#include "UploadManager.h"
+
+namespace Rendering
+{
+UploadManager::UploadManager(vk::Device device, vk::Queue queue, uint32_t queueFamily)
+    : _device(device), _queue(queue), _queueFamily(queueFamily)
+{
+    vk::SemaphoreTypeCreateInfo semaphoreType{vk::SemaphoreType::eTimeline, 0};
+    _semaphore = _device.createSemaphore({{}, &semaphoreType}).value;
+
+    BeginBatch();
+}
+
+UploadManager::~UploadManager()
+{
+    WaitIdle();
+
+    _free.push_back(_open);
+    for (auto& batch : _free)
+        _device.destroyCommandPool(batch.commandPool);
+
+    _device.destroySemaphore(_semaphore);
+}
+
+void UploadManager::BeginBatch()
+{
+    if (_free.empty())
+    {
+        Batch batch;
+        batch.commandPool = _device.createCommandPool({vk::CommandPoolCreateFlagBits::eTransient, _queueFamily}).value;
+        batch.commandBuffer = _device.allocateCommandBuffers({batch.commandPool, vk::CommandBufferLevel::ePrimary, 1}).value.front();
+        _free.push_back(batch);
+    }
+
+    _open = _free.back();
+    _free.pop_back();
+
+    auto beginResult = _open.commandBuffer.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    if (beginResult != vk::Result::eSuccess)
+    {
+        spdlog::warn("[Vulkan] UploadManager begin: {}", vk::to_string(beginResult));
+    }
+    _hasCommands = false;
+}
+
+void UploadManager::Record(std::function<void(vk::CommandBuffer)> func, std::vector<std::shared_ptr<void>> keepAlive)
+{
+    std::lock_guard lock{_mutex};
+
+    func(_open.commandBuffer);
+    _open.keepAlive.insert(_open.keepAlive.end(), keepAlive.begin(), keepAlive.end());
+    _hasCommands = true;
+}
+
+uint64_t UploadManager::Flush()
+{
+    std::lock_guard lock{_mutex};
+
+    Collect();
+
+    if (!_hasCommands)
+        return _submittedValue;
+
+    auto endResult = _open.commandBuffer.end();
+    if (endResult != vk::Result::eSuccess)
+    {
+        spdlog::warn("[Vulkan] UploadManager end: {}", vk::to_string(endResult));
+    }
+
+    _open.value = ++_submittedValue;
+
+    const vk::CommandBufferSubmitInfoKHR cmdBufferSubmit{_open.commandBuffer};
+    const vk::SemaphoreSubmitInfoKHR signalSemaphore{_semaphore, _open.value, vk::PipelineStageFlagBits2KHR::eAllCommands, 0};
+    const vk::SubmitInfo2KHR submitInfo{{}, 0, nullptr, 1, &cmdBufferSubmit, 1, &signalSemaphore};
+
+    auto submitResult = _queue.submit2KHR(1, &submitInfo, {});
+    if (submitResult != vk::Result::eSuccess)
+    {
+        spdlog::warn("[Vulkan] UploadManager submit2KHR: {}", vk::to_string(submitResult));
+    }
+
+    _pending.push_back(std::move(_open));
+    BeginBatch();
+
+    return _submittedValue;
+}
+
+void UploadManager::Wait(uint64_t value)
+{
+    const vk::SemaphoreWaitInfo waitInfo{{}, 1, &_semaphore, &value};
+    auto waitResult = _device.waitSemaphores(waitInfo, UINT64_MAX);
+    if (waitResult != vk::Result::eSuccess)
+    {
+        spdlog::warn("[Vulkan] UploadManager waitSemaphores: {}", vk::to_string(waitResult));
+    }
+
+    std::lock_guard lock{_mutex};
+    Collect();
+}
+
+void UploadManager::WaitIdle()
+{
+    Wait(Flush());
+}
+
+// Releases what finished batches kept alive and recycles their pools.
+void UploadManager::Collect()
+{
+    const auto completed = _device.getSemaphoreCounterValue(_semaphore).value;
+
+    auto finished = std::partition(_pending.begin(), _pending.end(), [completed](const Batch& batch) { return batch.value > completed; });
+    for (auto it = finished; it != _pending.end(); ++it)
+    {
+        it->keepAlive.clear();
+        auto resetResult = _device.resetCommandPool(it->commandPool, {});
+        _free.push_back(std::move(*it));
+    }
+    _pending.erase(finished, _pending.end());
+}
+} // namespace Rendering
\ No newline at end of file
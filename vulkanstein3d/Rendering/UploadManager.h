@@ -0,0 +1,55 @@
+#pragma once
+
+#include "../Common.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Rendering
+{
+// Batches transfer commands into one submission on the transfer queue. Each batch signals a value on a timeline
+// semaphore, the renderer waits for the latest one before drawing, so uploads never stall the CPU.
+class UploadManager
+{
+  public:
+    UploadManager(vk::Device device, vk::Queue queue, uint32_t queueFamily);
+    ~UploadManager();
+
+    // Records into the open batch, safe to call from any thread. keepAlive (staging buffers etc.) is released once the batch has finished.
+    void Record(std::function<void(vk::CommandBuffer)> func, std::vector<std::shared_ptr<void>> keepAlive = {});
+    // Submits the open batch if it has commands. Returns the timeline value that signals when everything recorded so far is done.
+    uint64_t Flush();
+    void Wait(uint64_t value);
+    // Flushes and waits for all uploads.
+    void WaitIdle();
+
+    vk::Semaphore GetSemaphore() const { return _semaphore; }
+
+  private:
+    struct Batch
+    {
+        vk::CommandPool commandPool{};
+        vk::CommandBuffer commandBuffer{};
+        uint64_t value{};
+        std::vector<std::shared_ptr<void>> keepAlive;
+    };
+
+    void BeginBatch();
+    void Collect();
+
+  private:
+    vk::Device _device{};
+    vk::Queue _queue{};
+    uint32_t _queueFamily{};
+    vk::Semaphore _semaphore{};
+
+    std::mutex _mutex;
+    Batch _open;
+    bool _hasCommands{false};
+    uint64_t _submittedValue{0};
+    std::vector<Batch> _pending; // submitted, not yet finished
+    std::vector<Batch> _free;    // finished, pools reset and ready for reuse
+};
+} // namespace Rendering
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform usampler2DArray textures;
+
+layout(set = 0, binding = 1) readonly buffer Palette {
+    uint colors[];
+} palette;
+
+layout(location = 0) in struct {
+    vec3 uvTile;
+} In;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    uint index = texture(textures, In.uvTile.xyz).r;
+    outColor = unpackUnorm4x8(palette.colors[index]);
+    if (outColor.a < 0.9) discard;
+}
@@ -13,15 +13,16 @@ layout(push_constant) uniform FrameConstants
     mat4 mvp;
 } consts;
 
-layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inUvTile;
+// Packed vertex, see Game::PackedVertex.
+layout(location = 0) in ivec4 inPos;
+layout(location = 1) in vec4 inNormal;
+layout(location = 2) in uvec4 inUvTile;
 
 layout(location = 0) out vec3 outNormal;
 layout(location = 1) out vec3 outUvTile;
 
 void main() {    
-    outNormal = inNormal;
-    outUvTile = inUvTile;
-    gl_Position = consts.mvp * vec4(inPos, 1.0);
+    outNormal = inNormal.xyz;
+    outUvTile = vec3(inUvTile.xyz);
+    gl_Position = consts.mvp * vec4(inPos.xyz, 1.0);
 }
\ No newline at end of file
@@ -1,14 +1,19 @@
 #version 450
 
+struct ObjectData{
+    mat4 model;
+    vec4 data;
+};
+
 layout(push_constant) uniform ObjectPushConstants
 {
-    mat4 mvp;
-    float tileIndex;
-    float padding0;
-    float padding1;
-    float padding2;    
+    mat4 viewProjection;
 } consts;
 
+layout(set = 0, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} object;
+
 layout(location = 0) in vec3 inPos;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec3 inUvTile;
@@ -18,6 +23,6 @@ layout(location = 1) out vec3 outUvTile;
 
 void main() {    
     outNormal = inNormal;
-    outUvTile = vec3(inUvTile.xy, consts.tileIndex);
-    gl_Position = consts.mvp * vec4(inPos, 1.0);
+    outUvTile = vec3(inUvTile.xy, object.objects[gl_InstanceIndex].data.x);
+    gl_Position = consts.viewProjection * object.objects[gl_InstanceIndex].model * vec4(inPos, 1.0);
 }
\ No newline at end of file
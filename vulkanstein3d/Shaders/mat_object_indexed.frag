@@ -0,0 +1,17 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform usampler2DArray textures;
+
+layout(set = 0, binding = 1) readonly buffer Palette {
+    uint colors[];
+} palette;
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec3 inUvTile;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    uint index = texture(textures, inUvTile.xyz).r;
+    outColor = unpackUnorm4x8(palette.colors[index]);
+}
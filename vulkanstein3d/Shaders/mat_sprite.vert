@@ -11,8 +11,8 @@ const vec2 uvs[6] = vec2[]
 );
 
 struct SpriteData{
-	mat4 model;
-    vec4 data;
+	vec3 position;
+	uint spriteIndex;
 };
 
 layout(set = 0, binding = 1) uniform FrameConstants {
@@ -43,7 +43,9 @@ void main() {
     pos += sizex * (0.5 - uv.x) * rightWs;
     pos += sizey * (0.5 - uv.y) * upWs;
 
-    outUvTile = vec3(1 - uv.x, uv.y, object.sprites[gl_InstanceIndex].data.x);
+    SpriteData sprite = object.sprites[gl_InstanceIndex];
 
-    gl_Position = frame.projection * frame.view * object.sprites[gl_InstanceIndex].model * vec4(pos, 1.0);
+    outUvTile = vec3(1 - uv.x, uv.y, float(sprite.spriteIndex));
+
+    gl_Position = frame.projection * frame.view * vec4(sprite.position + pos, 1.0);
 }
@@ -0,0 +1,18 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform usampler2DArray textures;
+
+layout(set = 0, binding = 3) readonly buffer Palette {
+    uint colors[];
+} palette;
+
+layout(location = 0) in vec3 inUvTile;
+
+layout(location = 0) out vec4 outColor;
+
+void main(void)
+{
+    uint index = texture(textures, inUvTile).r;
+    outColor = unpackUnorm4x8(palette.colors[index]);
+    if (outColor.a < 0.9) discard;
+}
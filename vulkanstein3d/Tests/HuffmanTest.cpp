@@ -0,0 +1,177 @@
+#include "../Wolf3dLoaders/GraphicsArchive.h"
+#include "../Wolf3dLoaders/Huffman.h"
+
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <span>
+#include <vector>
+
+using namespace Wolf3dLoaders;
+
+// Both decoders on one compressed chunk (without its length), true when they agree byte for byte.
+static bool CompareDecoders(std::span<const uint8_t> codes, int32_t length, HuffmanTable& table, std::vector<uint8_t>& decoded)
+{
+    // Padded for the reference decoder, which reads one byte past the last code.
+    std::vector<uint8_t> source(codes.begin(), codes.end());
+    source.push_back(0);
+
+    std::vector<uint8_t> reference(length);
+    decoded.assign(length, 0);
+    HuffmanExpand(source.data(), reference.data(), length, table.tree.data());
+    HuffmanExpandTable(source.data(), source.size() - 1, decoded.data(), length, table);
+
+    const auto [expected, actual] = std::mismatch(reference.begin(), reference.end(), decoded.begin());
+    if (expected == reference.end())
+        return true;
+
+    spdlog::error("Byte {} of {} is {}, expected {}", expected - reference.begin(), length, *actual, *expected);
+    return false;
+}
+
+// Huffman tree over skewed byte frequencies, so rare bytes get codes longer than HuffmanLookupBits.
+// Node values up to 0xFF are bytes, above that 256 + node index, the root is node 254 like in VGADICT.
+static std::vector<HuffmanNode> BuildSkewedTree(std::mt19937& random)
+{
+    using Entry = std::pair<uint64_t, int16_t>; // weight, node value
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int16_t value = 0; value <= 0xFF; value++)
+        queue.push({1 + (random() % 4) * (value < 16 ? 10000 : 1), value});
+
+    std::vector<HuffmanNode> tree;
+    while (queue.size() > 1)
+    {
+        const auto [weight0, node0] = queue.top();
+        queue.pop();
+        const auto [weight1, node1] = queue.top();
+        queue.pop();
+
+        tree.push_back({node0, node1});
+        queue.push({weight0 + weight1, (int16_t)(256 + tree.size() - 1)});
+    }
+
+    return tree;
+}
+
+// Codes in tree order, bit i of a code is the branch taken at depth i.
+static void CollectCodes(const std::vector<HuffmanNode>& tree, int16_t nodeValue, std::vector<bool>& code, std::vector<std::vector<bool>>& codes)
+{
+    if (nodeValue <= 0xFF)
+    {
+        codes[nodeValue] = code;
+        return;
+    }
+
+    const auto& node = tree[nodeValue - 256];
+    code.push_back(false);
+    CollectCodes(tree, node.node0, code, codes);
+    code.back() = true;
+    CollectCodes(tree, node.node1, code, codes);
+    code.pop_back();
+}
+
+// Random payloads encoded with a tree that has codes longer than the lookup, no game data needed.
+static bool TestSyntheticTree()
+{
+    std::mt19937 random{1234};
+
+    auto tree = BuildSkewedTree(random);
+    auto table = BuildHuffmanTable(tree.data());
+
+    std::vector<std::vector<bool>> codes(256);
+    std::vector<bool> code;
+    CollectCodes(tree, 256 + 254, code, codes);
+
+    const auto longest = std::max_element(codes.begin(), codes.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); })->size();
+    if (longest <= (size_t)HuffmanLookupBits)
+    {
+        spdlog::error("Synthetic tree has no codes longer than {} bits", HuffmanLookupBits);
+        return false;
+    }
+
+    int failed = 0;
+    for (int payload = 0; payload < 64; payload++)
+    {
+        std::vector<uint8_t> bytes(1 + random() % 4096);
+        for (auto& byte : bytes)
+            byte = (uint8_t)random();
+
+        // Bits go in from the lowest bit of each byte up.
+        std::vector<uint8_t> encoded;
+        size_t bitCount = 0;
+        for (const auto byte : bytes)
+        {
+            for (const bool bit : codes[byte])
+            {
+                if (bitCount % 8 == 0)
+                    encoded.push_back(0);
+                encoded.back() |= (uint8_t)bit << (bitCount % 8);
+                bitCount++;
+            }
+        }
+
+        std::vector<uint8_t> decoded;
+        if (!CompareDecoders(encoded, (int32_t)bytes.size(), table, decoded) || decoded != bytes)
+        {
+            spdlog::error("Synthetic payload {} of {} bytes doesn't round trip", payload, bytes.size());
+            failed++;
+        }
+    }
+
+    spdlog::info("Huffman decoders compared on 64 synthetic payloads, longest code {} bits, {} differ", longest, failed);
+    return failed == 0;
+}
+
+// Every VGAGRAPH chunk has to match the reference decoder byte for byte.
+static bool TestGraphicsArchive(const char* dataPath)
+{
+    auto archive = GraphicsArchive::Load(dataPath);
+    if (!archive)
+        return false;
+
+    // The reference decoder takes a mutable tree.
+    auto table = archive->GetHuffmanTable();
+
+    int checked = 0;
+    int failed = 0;
+    std::vector<uint8_t> decoded;
+    for (int chunk = 0; chunk < archive->GetChunkCount(); chunk++)
+    {
+        const auto data = archive->GetChunkData(chunk);
+        if (data.size() <= sizeof(int32_t))
+            continue;
+
+        int32_t length = 0;
+        std::memcpy(&length, data.data(), sizeof(int32_t));
+        if (length <= 0)
+            continue;
+
+        if (!CompareDecoders(data.subspan(sizeof(int32_t)), length, table, decoded))
+        {
+            spdlog::error("Chunk {} differs", chunk);
+            failed++;
+        }
+        checked++;
+    }
+
+    spdlog::info("Huffman decoders compared on {} chunks, {} differ", checked, failed);
+    if (checked == 0)
+        spdlog::error("No VGAGRAPH chunks found in {}", dataPath);
+
+    return checked > 0 && failed == 0;
+}
+
+// Golden test for the table-driven Huffman decoder against the reference one. The synthetic tree always runs,
+// VGAGRAPH chunks are checked when the Wolf3D directory is passed as an argument.
+int main(int argc, char* argv[])
+{
+    bool passed = TestSyntheticTree();
+
+    if (argc > 1)
+        passed = TestGraphicsArchive(argv[1]) && passed;
+
+    return passed ? 0 : 1;
+}
\ No newline at end of file
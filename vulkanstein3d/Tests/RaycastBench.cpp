@@ -0,0 +1,78 @@
+#include "../Common.h"
+
+#include "../Game/Level.h"
+#include "../Wolf3dLoaders/Loaders.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+
+constexpr int DirectionsPerTile = 64;
+constexpr int Runs = 20;
+
+// Times the level's batched raycast, rays go out in every direction from the centre of each open tile.
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        spdlog::warn("Pass path to Wolf3D directory as an argument, optionally followed by episode and floor.");
+        return 1;
+    }
+
+    const int episode = argc > 2 ? std::stoi(argv[2]) : 1;
+    const int floor = argc > 3 ? std::stoi(argv[3]) : 1;
+
+    Wolf3dLoaders::Loaders loaders{argv[1]};
+    auto map = loaders.LoadMap(episode, floor);
+    if (!map)
+        return 1;
+
+    // The same grid and entities the game traces against, without the GPU side.
+    Game::Level level{map};
+    const auto& grid = level.GetCollisionGrid();
+    const float tileSize = 10.0f;
+
+    std::vector<Game::Ray> rays;
+    for (int y = 0; y < grid.GetWidth(); y++)
+    {
+        for (int x = 0; x < grid.GetWidth(); x++)
+        {
+            if (grid.Test({x, y}, Game::TileBlocksMovement | Game::TileBlocksShooting))
+                continue;
+
+            const glm::vec2 origin{(x + 0.5f) * tileSize, (y + 0.5f) * tileSize};
+            for (int i = 0; i < DirectionsPerTile; i++)
+            {
+                const float angle = glm::two_pi<float>() * (i + 0.5f) / DirectionsPerTile;
+                rays.push_back({origin, {std::cos(angle), std::sin(angle)}, grid.GetWidth() * tileSize});
+            }
+        }
+    }
+    std::vector<Game::RayHit> hits(rays.size());
+
+    // Best of several runs, the first one also warms the caches.
+    double best = std::numeric_limits<double>::max();
+    for (int run = 0; run < Runs; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        level.Raycast(rays, hits, true);
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+
+    int wallHits = 0;
+    int doorHits = 0;
+    int spriteHits = 0;
+    for (const auto& hit : hits)
+    {
+        wallHits += hit.type == Game::RayHit::Type::Wall;
+        doorHits += hit.type == Game::RayHit::Type::Door;
+        spriteHits += hit.type == Game::RayHit::Type::Sprite;
+    }
+
+    spdlog::info("E{}M{}: {} rays, {:.1f} ns per ray ({} walls, {} doors, {} sprites)", episode, floor, rays.size(), best / rays.size(), wallHits, doorHits,
+                 spriteHits);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include "FileView.h"
+
+#include "spdlog/spdlog.h"
+
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Wolf3dLoaders
+{
+static const uint8_t* MapFile(const std::filesystem::path& path, size_t& size)
+{
+#ifdef _WIN32
+    auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return nullptr;
+
+    // The view keeps the mapping object alive.
+    auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr)
+        return nullptr;
+
+    size = (size_t)fileSize.QuadPart;
+    return reinterpret_cast<const uint8_t*>(view);
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED)
+        return nullptr;
+
+    size = (size_t)st.st_size;
+    return reinterpret_cast<const uint8_t*>(view);
+#endif
+}
+
+static void UnmapFile(const uint8_t* mapping, size_t size)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+#else
+    munmap(const_cast<uint8_t*>(mapping), size);
+#endif
+}
+
+std::shared_ptr<FileView> FileView::Open(const std::filesystem::path& path)
+{
+    static std::mutex viewsMutex;
+    static std::map<std::filesystem::path, std::weak_ptr<FileView>> views;
+
+    std::error_code ec;
+    const auto key = std::filesystem::weakly_canonical(path, ec);
+
+    std::lock_guard lock{viewsMutex};
+
+    auto iter = views.find(key);
+    if (iter != views.end())
+    {
+        if (auto view = iter->second.lock())
+            return view;
+    }
+
+    std::shared_ptr<FileView> view;
+
+    size_t size = 0;
+    if (auto mapping = MapFile(path, size); mapping != nullptr)
+    {
+        view = std::make_shared<FileView>(mapping, size);
+    }
+    else
+    {
+        // Fall back to a buffered read.
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open())
+        {
+            spdlog::error("[Wolf3dLoaders] Couldn't open '{}'", path.string());
+            return nullptr;
+        }
+
+        std::vector<uint8_t> buffer((size_t)file.tellg());
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+
+        view = std::make_shared<FileView>(std::move(buffer));
+    }
+
+    views[key] = view;
+    return view;
+}
+
+FileView::FileView(const uint8_t* mapping, size_t size)
+    : _data(mapping, size), _mapping(mapping)
+{
+}
+
+FileView::FileView(std::vector<uint8_t> buffer)
+    : _buffer(std::move(buffer))
+{
+    _data = _buffer;
+}
+
+FileView::~FileView()
+{
+    if (_mapping != nullptr)
+        UnmapFile(_mapping, _data.size());
+}
+
+std::span<const uint8_t> FileView::Slice(size_t offset, size_t length) const
+{
+    if (offset > _data.size() || length > _data.size() - offset)
+        return {};
+
+    return _data.subspan(offset, length);
+}
+} // namespace Wolf3dLoaders
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Wolf3dLoaders
+{
+// Read-only view of a whole data file. The file is memory mapped when possible and read into
+// memory otherwise. Opening the same file again returns the existing view.
+class FileView
+{
+  public:
+    static std::shared_ptr<FileView> Open(const std::filesystem::path& path);
+
+    FileView(const uint8_t* mapping, size_t size);
+    FileView(std::vector<uint8_t> buffer);
+    ~FileView();
+
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    std::span<const uint8_t> Data() const { return _data; }
+    size_t GetSize() const { return _data.size(); }
+
+    // Returns an empty span if the range is outside the file.
+    std::span<const uint8_t> Slice(size_t offset, size_t length) const;
+
+  private:
+    std::span<const uint8_t> _data;
+    const uint8_t* _mapping{nullptr};
+    std::vector<uint8_t> _buffer;
+};
+} // namespace Wolf3dLoaders
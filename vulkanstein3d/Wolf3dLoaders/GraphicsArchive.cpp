@@ -0,0 +1,121 @@
+#include "GraphicsArchive.h"
+#include "FileView.h"
+#include "Huffman.h"
+
+#include "spdlog/spdlog.h"
+
+#include <cstring>
+#include <fstream>
+
+// https://github.com/id-Software/wolf3d/blob/master/WOLFSRC/ID_CA.C
+namespace Wolf3dLoaders
+{
+constexpr int GraphicsChunks = 149;
+constexpr int StartPictures = 3;
+constexpr int PictureCount = 132;
+
+std::shared_ptr<GraphicsArchive> GraphicsArchive::Load(const std::filesystem::path& dataPath)
+{
+    spdlog::info("[Wolf3dLoaders] Loading graphics archive");
+
+    std::ifstream dictFile((dataPath / "VGADICT.WL6"), std::ios::binary);
+    std::ifstream headFile((dataPath / "VGAHEAD.WL6"), std::ios::binary);
+    auto graphFile = FileView::Open(dataPath / "VGAGRAPH.WL6");
+
+    if (!dictFile.is_open() || !headFile.is_open() || !graphFile)
+    {
+        spdlog::error("[Wolf3dLoaders] Couldn't open graphics datafile");
+        return nullptr;
+    }
+
+    std::vector<HuffmanNode> huffmanTree(255);
+    dictFile.read(reinterpret_cast<char*>(huffmanTree.data()), sizeof(HuffmanNode) * huffmanTree.size());
+
+    std::vector<int32_t> offsets(GraphicsChunks);
+    unsigned char bytes[3] = {};
+    for (int i = 0; i < GraphicsChunks; i++)
+    {
+        headFile.read(reinterpret_cast<char*>(bytes), sizeof(unsigned char) * 3);
+
+        offsets[i] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+        if (offsets[i] == 0x00FFFFFF)
+            offsets[i] = -1;
+    }
+
+    auto huffmanTable = std::make_unique<HuffmanTable>(BuildHuffmanTable(huffmanTree.data()));
+
+    return std::make_shared<GraphicsArchive>(std::move(huffmanTable), std::move(offsets), graphFile);
+}
+
+GraphicsArchive::GraphicsArchive(std::unique_ptr<HuffmanTable> huffmanTable, std::vector<int32_t> offsets, std::shared_ptr<FileView> graphFile)
+    : _huffmanTable(std::move(huffmanTable)), _offsets(std::move(offsets)), _graphFile(graphFile)
+{
+    // Chunk 0 holds the width and height of every picture.
+    const auto expanded = ExpandChunk(0);
+
+    _picTable.resize(std::min<size_t>(PictureCount, expanded.size() / 4));
+    for (size_t i = 0; i < _picTable.size(); ++i)
+    {
+        _picTable[i].width = expanded[4 * i] | (expanded[4 * i + 1] << 8);
+        _picTable[i].height = expanded[4 * i + 2] | (expanded[4 * i + 3] << 8);
+    }
+}
+
+GraphicsArchive::~GraphicsArchive()
+{
+}
+
+std::span<const uint8_t> GraphicsArchive::GetChunkData(int chunk) const
+{
+    if (chunk < 0 || chunk >= GetChunkCount() || _offsets[chunk] == -1)
+        return {};
+
+    // Sparse chunks are marked with -1, length runs to the next present chunk.
+    int next = chunk + 1;
+    while (next < GetChunkCount() && _offsets[next] == -1)
+        ++next;
+
+    return _offsets[next] > _offsets[chunk] ? _graphFile->Slice(_offsets[chunk], _offsets[next] - _offsets[chunk]) : std::span<const uint8_t>{};
+}
+
+std::vector<uint8_t> GraphicsArchive::ExpandChunk(int chunk) const
+{
+    if (chunk < 0 || chunk >= GetChunkCount() || _offsets[chunk] == -1)
+    {
+        spdlog::error("[Wolf3dLoaders] Invalid graphics chunk {}", chunk);
+        return {};
+    }
+
+    const auto data = GetChunkData(chunk);
+    if (data.size() <= sizeof(int32_t))
+    {
+        spdlog::error("[Wolf3dLoaders] Corrupt graphics chunk {}", chunk);
+        return {};
+    }
+
+    int32_t expandedLength = 0;
+    std::memcpy(&expandedLength, data.data(), sizeof(int32_t));
+
+    // Every code takes at least one bit, a longer length can't come from this chunk.
+    const auto codeBits = (data.size() - sizeof(int32_t)) * 8;
+    if (expandedLength <= 0 || (size_t)expandedLength > codeBits)
+    {
+        spdlog::error("[Wolf3dLoaders] Corrupt length {} in graphics chunk {}", expandedLength, chunk);
+        return {};
+    }
+
+    std::vector<uint8_t> expanded(expandedLength);
+    HuffmanExpandTable(data.data() + sizeof(int32_t), data.size() - sizeof(int32_t), expanded.data(), expandedLength, *_huffmanTable);
+
+    return expanded;
+}
+
+PictureSize GraphicsArchive::GetPictureSize(int pictureIndex) const
+{
+    const auto index = pictureIndex - StartPictures;
+    if (index < 0 || index >= (int)_picTable.size())
+        return {};
+
+    return _picTable[index];
+}
+} // namespace Wolf3dLoaders
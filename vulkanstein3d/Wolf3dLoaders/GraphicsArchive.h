@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Wolf3dLoaders
+{
+class FileView;
+struct HuffmanTable;
+
+struct PictureSize
+{
+    int16_t width{};
+    int16_t height{};
+};
+
+// VGADICT/VGAHEAD/VGAGRAPH parsed once, serving Huffman compressed chunks by index.
+class GraphicsArchive
+{
+  public:
+    static std::shared_ptr<GraphicsArchive> Load(const std::filesystem::path& dataPath);
+
+    GraphicsArchive(std::unique_ptr<HuffmanTable> huffmanTable, std::vector<int32_t> offsets, std::shared_ptr<FileView> graphFile);
+    ~GraphicsArchive();
+
+    int GetChunkCount() const { return (int)_offsets.size() - 1; }
+    // Compressed chunk as stored, a 32-bit expanded length followed by the Huffman codes. Empty for sparse chunks.
+    std::span<const uint8_t> GetChunkData(int chunk) const;
+    const HuffmanTable& GetHuffmanTable() const { return *_huffmanTable; }
+
+    std::vector<uint8_t> ExpandChunk(int chunk) const;
+    PictureSize GetPictureSize(int pictureIndex) const;
+
+  private:
+    std::unique_ptr<HuffmanTable> _huffmanTable;
+    std::vector<int32_t> _offsets;
+    std::shared_ptr<FileView> _graphFile;
+    std::vector<PictureSize> _picTable;
+};
+} // namespace Wolf3dLoaders
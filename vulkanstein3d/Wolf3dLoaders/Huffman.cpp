@@ -0,0 +1,142 @@
+#include "Huffman.h"
+
+#include <algorithm>
+
+namespace Wolf3dLoaders
+{
+int HuffmanExpand(uint8_t* source, uint8_t* destination, int32_t length, HuffmanNode* tree)
+{
+    uint8_t* read = source;
+    uint8_t* write = destination;
+    uint8_t mask = 0x01;
+    uint8_t input = *(read++);
+
+    int16_t nodeValue;
+    HuffmanNode* node = &tree[254];
+    int32_t bytesWritten = 0;
+
+    while (1)
+    {
+        if ((input & mask) == 0)
+            nodeValue = node->node0;
+        else
+            nodeValue = node->node1;
+
+        if (mask == 0x80)
+        {
+            input = *(read++);
+            mask = 0x01;
+        }
+        else
+        {
+            mask <<= 1;
+        }
+
+        if (nodeValue <= 0xFF)
+        {
+            *(write++) = (uint8_t)nodeValue;
+            node = &tree[254];
+            if ((++bytesWritten) == length)
+                break;
+        }
+        else
+        {
+            node = tree + nodeValue - 256;
+        }
+    }
+
+    return 0;
+}
+
+HuffmanTable BuildHuffmanTable(const HuffmanNode* tree)
+{
+    HuffmanTable table{};
+    std::copy(tree, tree + table.tree.size(), table.tree.begin());
+
+    for (uint32_t code = 0; code < table.entries.size(); code++)
+    {
+        auto& entry = table.entries[code];
+
+        int16_t nodeIndex = 254;
+        entry = {nodeIndex, HuffmanLookupBits, false};
+
+        for (uint8_t bit = 0; bit < HuffmanLookupBits; bit++)
+        {
+            const auto& node = table.tree[nodeIndex];
+            const int16_t nodeValue = ((code >> bit) & 1) == 0 ? node.node0 : node.node1;
+            if (nodeValue <= 0xFF)
+            {
+                entry = {nodeValue, (uint8_t)(bit + 1), true};
+                break;
+            }
+
+            nodeIndex = nodeValue - 256;
+            entry.value = nodeIndex;
+        }
+    }
+
+    return table;
+}
+
+int HuffmanExpandTable(const uint8_t* source, size_t sourceLength, uint8_t* destination, int32_t length, const HuffmanTable& table)
+{
+    constexpr uint64_t lookupMask = (1 << HuffmanLookupBits) - 1;
+
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+    size_t readPos = 0;
+
+    // Keeps at least 57 bits in the buffer, reading zeroes past the end of the source.
+    auto refill = [&]() {
+        while (bitCount <= 56)
+        {
+            const uint64_t byte = readPos < sourceLength ? source[readPos] : 0;
+            bitBuffer |= byte << bitCount;
+            bitCount += 8;
+            readPos++;
+        }
+    };
+
+    int32_t bytesWritten = 0;
+    while (bytesWritten < length)
+    {
+        refill();
+
+        while (bitCount >= HuffmanLookupBits && bytesWritten < length)
+        {
+            const auto& entry = table.entries[bitBuffer & lookupMask];
+            bitBuffer >>= entry.bits;
+            bitCount -= entry.bits;
+
+            if (entry.isLeaf)
+            {
+                destination[bytesWritten++] = (uint8_t)entry.value;
+                continue;
+            }
+
+            // Long code, continue one bit at a time.
+            int16_t nodeIndex = entry.value;
+            while (1)
+            {
+                if (bitCount == 0)
+                    refill();
+
+                const auto& node = table.tree[nodeIndex];
+                const int16_t nodeValue = (bitBuffer & 1) == 0 ? node.node0 : node.node1;
+                bitBuffer >>= 1;
+                bitCount--;
+
+                if (nodeValue <= 0xFF)
+                {
+                    destination[bytesWritten++] = (uint8_t)nodeValue;
+                    break;
+                }
+
+                nodeIndex = nodeValue - 256;
+            }
+        }
+    }
+
+    return 0;
+}
+} // namespace Wolf3dLoaders
\ No newline at end of file
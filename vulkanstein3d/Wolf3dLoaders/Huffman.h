@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// https://github.com/id-Software/wolf3d/blob/master/WOLFSRC/ID_CA.C
+namespace Wolf3dLoaders
+{
+#pragma pack(push, 2)
+struct HuffmanNode
+{
+    int16_t node0;
+    int16_t node1;
+};
+#pragma pack(pop)
+
+// Decodes up to HuffmanLookupBits bits per step. Codes longer than that fall back to walking
+// the tree from the node reached after the first HuffmanLookupBits bits.
+constexpr int HuffmanLookupBits = 8;
+
+struct HuffmanLookupEntry
+{
+    int16_t value{0}; // Decoded byte for leaves, otherwise index of the node to continue from.
+    uint8_t bits{0};
+    bool isLeaf{false};
+};
+
+struct HuffmanTable
+{
+    std::array<HuffmanNode, 255> tree{};
+    std::array<HuffmanLookupEntry, 1 << HuffmanLookupBits> entries{};
+};
+
+HuffmanTable BuildHuffmanTable(const HuffmanNode* tree);
+
+// Reference decoder from ID_CA.C, one tree step per bit. It can read one byte past the last code.
+int HuffmanExpand(uint8_t* source, uint8_t* destination, int32_t length, HuffmanNode* tree);
+int HuffmanExpandTable(const uint8_t* source, size_t sourceLength, uint8_t* destination, int32_t length, const HuffmanTable& table);
+} // namespace Wolf3dLoaders
\ No newline at end of file
@@ -1,10 +1,14 @@
 #include "Loaders.h"
-#include "Palette.h"
+#include "FileView.h"
+#include "GraphicsArchive.h"
+#include "PaletteExpand.h"
+
+#include "../App/JobSystem.h"
 
 #include "spdlog/spdlog.h"
 
 #include <array>
-#include <fstream>
+#include <cstring>
 
 // https://github.com/id-Software/wolf3d/blob/master/WOLFSRC
 namespace Wolf3dLoaders
@@ -23,13 +27,6 @@ struct Chunks
     std::vector<uint16_t> lengths;
 };
 
-#pragma pack(2)
-struct HuffmanNode
-{
-    int16_t node0;
-    int16_t node1;
-};
-
 #pragma pack(2)
 struct LevelHeader
 {
@@ -47,20 +44,14 @@ struct MapHeader
     int32_t levelPointers[MaxLevels];
 };
 
-struct Size
-{
-    int16_t width;
-    int16_t height;
-};
-
-void CarmackExpand(uint8_t* source, uint16_t* dest, int length)
+void CarmackExpand(const uint8_t* source, uint16_t* dest, int length)
 {
     const uint16_t NEARTAG = 0xa7;
     const uint16_t FARTAG = 0xa8;
 
     length /= 2;
 
-    auto inptr = (uint8_t*)source;
+    auto inptr = source;
     auto outptr = dest;
 
     while (length > 0)
@@ -117,51 +108,7 @@ void CarmackExpand(uint8_t* source, uint16_t* dest, int length)
     }
 }
 
-int HuffmanExpand(uint8_t* source, uint8_t* destination, int32_t length, HuffmanNode* tree)
-{
-    uint8_t* read = source;
-    uint8_t* write = destination;
-    uint8_t mask = 0x01;
-    uint8_t input = *(read++);
-
-    int16_t nodeValue;
-    HuffmanNode* node = &tree[254];
-    int32_t bytesWritten = 0;
-
-    while (1)
-    {
-        if ((input & mask) == 0)
-            nodeValue = node->node0;
-        else
-            nodeValue = node->node1;
-
-        if (mask == 0x80)
-        {
-            input = *(read++);
-            mask = 0x01;
-        }
-        else
-        {
-            mask <<= 1;
-        }
-
-        if (nodeValue <= 0xFF)
-        {
-            *(write++) = (uint8_t)nodeValue;
-            node = &tree[254];
-            if ((++bytesWritten) == length)
-                break;
-        }
-        else
-        {
-            node = tree + nodeValue - 256;
-        }
-    }
-
-    return 0;
-}
-
-void RLEWexpand(uint16_t* source, uint16_t* dest, int32_t length, uint16_t rlewtag)
+void RLEWexpand(const uint16_t* source, uint16_t* dest, int32_t length, uint16_t rlewtag)
 {
     uint16_t value, count, i;
     uint16_t* end = dest + length / 2;
@@ -183,110 +130,92 @@ void RLEWexpand(uint16_t* source, uint16_t* dest, int32_t length, uint16_t rlewt
     } while (dest < end);
 }
 
-Chunks LoadChunks(std::ifstream& file)
+Chunks LoadChunks(std::span<const uint8_t> data)
 {
     Chunks chunks{};
-    file.read(reinterpret_cast<char*>(&chunks.chunks), sizeof(uint16_t));
-    file.read(reinterpret_cast<char*>(&chunks.spriteStart), sizeof(uint16_t));
-    file.read(reinterpret_cast<char*>(&chunks.soundStart), sizeof(uint16_t));
+    if (data.size() < sizeof(uint16_t) * 3)
+        return chunks;
+
+    std::memcpy(&chunks.chunks, data.data(), sizeof(uint16_t));
+    std::memcpy(&chunks.spriteStart, data.data() + 2, sizeof(uint16_t));
+    std::memcpy(&chunks.soundStart, data.data() + 4, sizeof(uint16_t));
+
+    const size_t offsetsStart = sizeof(uint16_t) * 3;
+    const size_t lengthsStart = offsetsStart + sizeof(uint32_t) * chunks.chunks;
+    if (data.size() < lengthsStart + sizeof(uint16_t) * chunks.chunks)
+    {
+        spdlog::error("[Wolf3dLoaders] Truncated chunk header");
+        return {};
+    }
 
     chunks.offsets.resize(chunks.chunks);
     chunks.lengths.resize(chunks.chunks);
 
-    file.read(reinterpret_cast<char*>(chunks.offsets.data()), sizeof(uint32_t) * chunks.chunks);
-    file.read(reinterpret_cast<char*>(chunks.lengths.data()), sizeof(uint16_t) * chunks.chunks);
+    std::memcpy(chunks.offsets.data(), data.data() + offsetsStart, sizeof(uint32_t) * chunks.chunks);
+    std::memcpy(chunks.lengths.data(), data.data() + lengthsStart, sizeof(uint16_t) * chunks.chunks);
 
     return chunks;
 }
 
+// Writes a row of indices either as is or expanded to RGBA8.
+void WriteTexels(const uint8_t* indices, uint8_t* dest, size_t count, PixelFormat format, bool transparent)
+{
+    if (format == PixelFormat::Indexed8)
+        std::memcpy(dest, indices, count);
+    else
+        ExpandPalette(indices, dest, count, GetPaletteTable(transparent));
+}
+
 Loaders::Loaders(const std::filesystem::path& dataPath)
     : _dataPath(dataPath)
 {
 }
 
-Bitmap Loaders::LoadPictureTexture(int pictureIndex)
+Bitmap Loaders::LoadPictureTexture(int pictureIndex, PixelFormat format)
 {
     spdlog::info("[Wolf3dLoaders] Loading picture {}", pictureIndex);
 
-    std::ifstream dictFile((_dataPath / "VGADICT.WL6"), std::ios::binary);
-
-    std::vector<HuffmanNode> huffmanTree(255);
-    dictFile.read(reinterpret_cast<char*>(huffmanTree.data()), sizeof(HuffmanNode) * huffmanTree.size());
+    if (!_graphics)
+        _graphics = GraphicsArchive::Load(_dataPath);
 
-    std::ifstream headFile((_dataPath / "VGAHEAD.WL6"), std::ios::binary);
-    std::vector<int32_t> offsets(149);
-    unsigned char bytes[3] = {};
-    for (int i = 0; i < 149; i++)
-    {
-        headFile.read(reinterpret_cast<char*>(bytes), sizeof(unsigned char) * 3);
-
-        offsets[i] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
-        if (offsets[i] == 0x00FFFFFF)
-            offsets[i] = -1;
-    }
-
-    std::ifstream graphFile((_dataPath / "VGAGRAPH.WL6"), std::ios::binary);
-    std::vector<Size> picTable(132);
-
-    const auto compressedLength = offsets[1] - offsets[0] - 4;
-    int32_t expandedLength = 0;
-    graphFile.read(reinterpret_cast<char*>(&expandedLength), sizeof(int32_t));
-
-    std::vector<uint8_t> compressed(compressedLength);
-    std::vector<uint8_t> expanded(expandedLength);
-
-    graphFile.read(reinterpret_cast<char*>(compressed.data()), compressedLength);
-
-    HuffmanExpand(compressed.data(), expanded.data(), expandedLength, huffmanTree.data());
+    if (!_graphics)
+        return {};
 
-    for (int i = 0; i < picTable.size(); ++i)
+    const auto imageExpanded = _graphics->ExpandChunk(pictureIndex);
+    const auto size = _graphics->GetPictureSize(pictureIndex);
+    if (size.width <= 0 || size.height <= 0 || imageExpanded.size() < (size_t)size.width * size.height)
     {
-        picTable[i].width = expanded[4 * i] | (expanded[4 * i + 1] << 8);
-        picTable[i].height = expanded[4 * i + 2] | (expanded[4 * i + 3] << 8);
+        spdlog::error("[Wolf3dLoaders] Picture {} is missing or truncated", pictureIndex);
+        return {};
     }
 
-    uint32_t picId = (uint32_t)pictureIndex;
-    uint32_t index = picId + 1;
-    while (offsets[index] == -1)
-        ++index;
-
-    const auto imageCompressedLength = offsets[index] - offsets[picId];
-    std::vector<uint8_t> imageCompressed(imageCompressedLength);
-
-    auto compressedChunkPtr = reinterpret_cast<int32_t*>(imageCompressed.data());
-
-    graphFile.seekg(offsets[picId], std::ios::beg);
-    graphFile.read(reinterpret_cast<char*>(imageCompressed.data()), sizeof(uint8_t) * imageCompressedLength);
-    auto imageExpandedLength = *(compressedChunkPtr++);
-    std::vector<uint8_t> imageExpanded(imageExpandedLength);
-
-    HuffmanExpand(reinterpret_cast<uint8_t*>(compressedChunkPtr), imageExpanded.data(), imageExpandedLength, huffmanTree.data());
-
     Bitmap bitmap;
-    bitmap.width = picTable[picId - 3].width;
-    bitmap.height = picTable[picId - 3].height;
+    bitmap.width = size.width;
+    bitmap.height = size.height;
     bitmap.layers = 1;
-    bitmap.data.resize(bitmap.width * bitmap.height * 4);
+    bitmap.format = format;
+    bitmap.data.resize(bitmap.width * bitmap.height * GetTexelSize(format));
 
+    // Pictures are stored as four planes, each holding every fourth column.
+    const size_t planeSize = (bitmap.width >> 2) * bitmap.height;
+    std::vector<uint8_t> indices(bitmap.width * bitmap.height);
     for (int y = 0; y < bitmap.height; y++)
-    {
-        for (int x = 0; x < bitmap.width; x++)
-        {
-            const auto& color = Palette[imageExpanded[(y * (bitmap.width >> 2) + (x >> 2)) + (x & 3) * (bitmap.width >> 2) * bitmap.height]];
-            std::memcpy(bitmap.data.data() + ((y * bitmap.width + x) * 4), &color, 4);
-        }
-    }
+        UnplanarizeRow(imageExpanded.data() + y * (bitmap.width >> 2), planeSize, bitmap.width, indices.data() + y * bitmap.width);
+
+    WriteTexels(indices.data(), bitmap.data.data(), indices.size(), format, false);
 
     return bitmap;
 }
 
-Bitmap Loaders::LoadWallTextures()
+Bitmap Loaders::LoadWallTextures(PixelFormat format)
 {
     spdlog::info("[Wolf3dLoaders] Loading wall textures");
 
-    std::ifstream file((_dataPath / "VSWAP.WL6"), std::ios::binary);
+    auto file = GetFile(_vswap, "VSWAP.WL6");
+    if (!file)
+        return {};
 
-    const auto chunks = Wolf3dLoaders::LoadChunks(file);
+    const auto chunks = Wolf3dLoaders::LoadChunks(file->Data());
 
     int wallImageFirst = 0;
     int wallImageLast = chunks.spriteStart;
@@ -294,34 +223,37 @@ Bitmap Loaders::LoadWallTextures()
     Bitmap bitmap;
     bitmap.width = bitmap.height = 64;
     bitmap.layers = wallImageLast;
-    bitmap.data.resize(bitmap.width * bitmap.height * 4 * wallImageLast);
-
-    std::vector<uint8_t> buffer(chunks.lengths[0]);
-    for (int i = wallImageFirst; i < wallImageLast; i++)
-    {
-        file.seekg(chunks.offsets[i], std::ios::beg);
-        file.read(reinterpret_cast<char*>(buffer.data()), chunks.lengths[i]);
-
-        for (int y = 0; y < 64; y++)
+    bitmap.format = format;
+    bitmap.data.resize(bitmap.width * bitmap.height * GetTexelSize(format) * wallImageLast);
+
+    // Every chunk writes its own layer, so the chunks can be decoded in any order.
+    ForEachChunk(wallImageLast - wallImageFirst, [&](int chunk) {
+        const auto i = wallImageFirst + chunk;
+        const auto buffer = file->Slice(chunks.offsets[i], chunks.lengths[i]);
+        if (buffer.size() < 64 * 64)
         {
-            for (int x = 0; x < 64; x++)
-            {
-                const auto& color = Palette[buffer[(x * 64 + y)]];
-                std::memcpy(bitmap.data.data() + (((y * 64 + x) + (i * 64 * 64)) * 4), &color, 4);
-            }
+            spdlog::warn("[Wolf3dLoaders] Wall chunk {} is truncated", i);
+            return;
         }
-    }
+
+        // Walls are stored column by column.
+        std::array<uint8_t, 64 * 64> indices;
+        TransposeIndices64(buffer.data(), indices.data());
+        WriteTexels(indices.data(), bitmap.data.data() + i * 64 * 64 * GetTexelSize(format), indices.size(), format, false);
+    });
 
     return bitmap;
 }
 
-Bitmap Loaders::LoadSpriteTextures()
+Bitmap Loaders::LoadSpriteTextures(PixelFormat format)
 {
     spdlog::info("[Wolf3dLoaders] Loading sprite textures");
 
-    std::ifstream file((_dataPath / "VSWAP.WL6"), std::ios::binary);
+    auto file = GetFile(_vswap, "VSWAP.WL6");
+    if (!file)
+        return {};
 
-    const auto chunks = Wolf3dLoaders::LoadChunks(file);
+    const auto chunks = Wolf3dLoaders::LoadChunks(file->Data());
 
     int spriteFirst = chunks.spriteStart;
     int spriteLast = chunks.soundStart;
@@ -329,53 +261,51 @@ Bitmap Loaders::LoadSpriteTextures()
     Bitmap bitmap;
     bitmap.width = bitmap.height = 64;
     bitmap.layers = spriteLast - spriteFirst;
-    bitmap.data.resize(64 * 64 * 4 * bitmap.layers);
-
-    std::vector<uint8_t> buffer(64 * 64);
+    bitmap.format = format;
+    bitmap.data.resize(64 * 64 * GetTexelSize(format) * bitmap.layers);
 
-    for (int i = spriteFirst; i < spriteLast; i++)
-    {
-        std::vector<uint8_t> compressedChunk(chunks.lengths[i]);
-
-        file.seekg(chunks.offsets[i], std::ios::beg);
-        file.read(reinterpret_cast<char*>(compressedChunk.data()), chunks.lengths[i]);
+    ForEachChunk(spriteLast - spriteFirst, [&](int chunk) {
+        const auto i = spriteFirst + chunk;
+        const auto compressedChunk = file->Slice(chunks.offsets[i], chunks.lengths[i]);
+        if (compressedChunk.size() < 4)
+        {
+            spdlog::warn("[Wolf3dLoaders] Sprite chunk {} is truncated", i);
+            return;
+        }
 
         auto firstColumn = static_cast<uint16_t>(compressedChunk[0]) | static_cast<uint16_t>((compressedChunk[1]) << 8);
         auto lastColumn = static_cast<uint16_t>(compressedChunk[2]) | static_cast<uint16_t>((compressedChunk[3]) << 8);
 
-        std::vector<uint16_t> columnOffsets((lastColumn - firstColumn + 1));
-        for (int i = 0; i <= lastColumn - firstColumn; i++)
-        {
-            columnOffsets[i] = compressedChunk[4 + 2 * i] | (compressedChunk[4 + 2 * i + 1] << 8);
-        }
-
-        std::memset(buffer.data(), 0xFF, 64 * 64);
+        // Scratch buffer per chunk so workers never share it.
+        std::array<uint8_t, 64 * 64> buffer;
+        buffer.fill(0xFF);
 
-        auto columnOffset = columnOffsets.data();
         for (uint16_t column = firstColumn; column <= lastColumn; ++column)
         {
-            auto drawingInstructions = reinterpret_cast<int16_t*>(compressedChunk.data() + *columnOffset);
+            const auto columnOffsetPos = 4 + 2 * (column - firstColumn);
+            const auto columnOffset = compressedChunk[columnOffsetPos] | (compressedChunk[columnOffsetPos + 1] << 8);
+
+            // Chunks in the mapped file aren't necessarily 2-byte aligned, read the posts bytewise.
+            auto drawingInstructions = compressedChunk.data() + columnOffset;
+            auto instruction = [&](uint32_t i) { return static_cast<int16_t>(drawingInstructions[i * 2] | (drawingInstructions[i * 2 + 1] << 8)); };
+
             uint32_t idx = 0;
-            while (drawingInstructions[idx] != 0)
+            while (instruction(idx) != 0)
             {
-                for (int row = drawingInstructions[idx + 2] / 2; row < drawingInstructions[idx] / 2; ++row)
+                for (int row = instruction(idx + 2) / 2; row < instruction(idx) / 2; ++row)
                 {
-                    buffer[column + (63 - row) * 64] = compressedChunk[drawingInstructions[idx + 1] + row];
+                    buffer[column + (63 - row) * 64] = compressedChunk[instruction(idx + 1) + row];
                 }
                 idx += 3;
             }
-            columnOffset++;
         }
 
+        // Rows are flipped, index 0xFF is transparent.
+        const auto texelSize = GetTexelSize(format);
+        const auto layer = bitmap.data.data() + (i - chunks.spriteStart) * 64 * 64 * texelSize;
         for (int y = 0; y < 64; y++)
-        {
-            for (int x = 0; x < 64; x++)
-            {
-                const auto color = buffer[(64 - 1 - y) * 64 + x] != 0xFF ? Palette[buffer[(64 - 1 - y) * 64 + x]] : Color{0, 0, 0, 0};
-                std::memcpy(bitmap.data.data() + (((y * 64 + x) + ((i - chunks.spriteStart) * 64 * 64)) * 4), &color, 4);
-            }
-        }
-    }
+            WriteTexels(buffer.data() + (64 - 1 - y) * 64, layer + y * 64 * texelSize, 64, format, true);
+    });
 
     return bitmap;
 }
@@ -384,17 +314,17 @@ std::shared_ptr<Map> Loaders::LoadMap(int episode, int level)
 {
     spdlog::info("[Wolf3dLoaders] Loading episode {} level {}", episode, level);
 
-    std::ifstream headerFile((_dataPath / "MAPHEAD.WL6"), std::ios::binary);
-    std::ifstream mapFile((_dataPath / "GAMEMAPS.WL6"), std::ios::binary);
+    auto headerFile = GetFile(_mapHead, "MAPHEAD.WL6");
+    auto mapFile = GetFile(_gameMaps, "GAMEMAPS.WL6");
 
-    if (!headerFile.is_open() || !mapFile.is_open())
+    if (!headerFile || !mapFile || headerFile->GetSize() < sizeof(MapHeader))
     {
         spdlog::error("[Wolf3dLoaders] Couldn't open datafile");
         return {};
     }
 
     MapHeader mapHeader{};
-    headerFile.read(reinterpret_cast<char*>(&mapHeader), sizeof(MapHeader));
+    std::memcpy(&mapHeader, headerFile->Data().data(), sizeof(MapHeader));
 
     const int levelIndex = (episode - 1) * EpisodeLevels + level - 1;
     if (mapHeader.levelPointers[levelIndex] == 0)
@@ -403,26 +333,36 @@ std::shared_ptr<Map> Loaders::LoadMap(int episode, int level)
         return {};
     }
 
+    const auto levelHeaderData = mapFile->Slice(mapHeader.levelPointers[levelIndex], sizeof(LevelHeader));
+    if (levelHeaderData.empty())
+    {
+        spdlog::error("[Wolf3dLoaders] Level header out of range");
+        return {};
+    }
+
     LevelHeader levelHeader{};
-    mapFile.seekg(mapHeader.levelPointers[levelIndex], std::ios::beg);
-    mapFile.read(reinterpret_cast<char*>(&levelHeader), sizeof(LevelHeader));
+    std::memcpy(&levelHeader, levelHeaderData.data(), sizeof(LevelHeader));
 
     const auto mapSize = levelHeader.width * levelHeader.width;
 
     auto map = std::make_shared<Map>();
     map->width = levelHeader.width;
+
+    std::vector<uint8_t> expandBuffer;
     for (auto plane = 0; plane < 2; plane++)
     {
-        std::vector<uint8_t> carmackBuffer(levelHeader.planeCompressedLength[plane]);
-        mapFile.seekg(levelHeader.planeOffset[plane], std::ios::beg);
-        mapFile.read(reinterpret_cast<char*>(carmackBuffer.data()), sizeof(uint8_t) * levelHeader.planeCompressedLength[plane]);
+        // Carmack data is expanded straight from the mapped file.
+        const auto carmackData = mapFile->Slice(levelHeader.planeOffset[plane], levelHeader.planeCompressedLength[plane]);
+        if (carmackData.size() < sizeof(uint16_t))
+        {
+            spdlog::error("[Wolf3dLoaders] Map plane {} out of range", plane);
+            return {};
+        }
 
-        auto source = reinterpret_cast<uint16_t*>(carmackBuffer.data());
-        auto expandedSize = *source;
-        source++;
+        const uint16_t expandedSize = carmackData[0] | (carmackData[1] << 8);
 
-        std::vector<uint8_t> expandBuffer(expandedSize);
-        CarmackExpand(reinterpret_cast<uint8_t*>(source), reinterpret_cast<uint16_t*>(expandBuffer.data()), expandedSize);
+        expandBuffer.resize(expandedSize);
+        CarmackExpand(carmackData.data() + sizeof(uint16_t), reinterpret_cast<uint16_t*>(expandBuffer.data()), expandedSize);
 
         map->tiles[plane].resize(mapSize);
         RLEWexpand((reinterpret_cast<uint16_t*>(expandBuffer.data())) + 1, reinterpret_cast<uint16_t*>(map->tiles[plane].data()), mapSize * 2, mapHeader.rlewMagic);
@@ -431,4 +371,25 @@ std::shared_ptr<Map> Loaders::LoadMap(int episode, int level)
     return map;
 }
 
-} // namespace Wolf3dLoaders
\ No newline at end of file
+void Loaders::ForEachChunk(int count, const std::function<void(int)>& func)
+{
+    if (_parallelDecode)
+    {
+        App::JobSystem::The().ParallelFor(count, func);
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+        func(i);
+}
+
+std::shared_ptr<FileView> Loaders::GetFile(std::shared_ptr<FileView>& file, const char* fileName)
+{
+    std::lock_guard lock{_fileMutex};
+    if (!file)
+        file = FileView::Open(_dataPath / fileName);
+
+    return file;
+}
+
+} // namespace Wolf3dLoaders
@@ -2,16 +2,34 @@
 
 #include <array>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace Wolf3dLoaders
 {
+class FileView;
+class GraphicsArchive;
+
+enum class PixelFormat
+{
+    Rgba8,
+    Indexed8 // raw palette indices, sprites use 0xFF for transparent texels
+};
+
+constexpr int GetTexelSize(PixelFormat format)
+{
+    return format == PixelFormat::Indexed8 ? 1 : 4;
+}
+
 struct Bitmap
 {
     std::vector<uint8_t> data;
     int width{};
     int height{};
     int layers{};
+    PixelFormat format{PixelFormat::Rgba8};
 };
 
 enum class MapObjects
@@ -233,12 +251,26 @@ class Loaders
   public:
     Loaders(const std::filesystem::path& dataPath);
 
-    Bitmap LoadPictureTexture(int pictureIndex);
-    Bitmap LoadWallTextures();
-    Bitmap LoadSpriteTextures();
+    Bitmap LoadPictureTexture(int pictureIndex, PixelFormat format = PixelFormat::Rgba8);
+    Bitmap LoadWallTextures(PixelFormat format = PixelFormat::Rgba8);
+    Bitmap LoadSpriteTextures(PixelFormat format = PixelFormat::Rgba8);
+    // Safe to call from a worker thread while the game runs.
     std::shared_ptr<Map> LoadMap(int episode, int level);
 
+    // Decodes VSWAP chunks across the job system, output is identical to the serial path.
+    void SetParallelDecode(bool parallelDecode) { _parallelDecode = parallelDecode; }
+
+  private:
+    void ForEachChunk(int count, const std::function<void(int)>& func);
+    std::shared_ptr<FileView> GetFile(std::shared_ptr<FileView>& file, const char* fileName);
+
   private:
     std::filesystem::path _dataPath;
+    std::shared_ptr<GraphicsArchive> _graphics;
+    std::shared_ptr<FileView> _vswap;
+    std::shared_ptr<FileView> _mapHead;
+    std::shared_ptr<FileView> _gameMaps;
+    std::mutex _fileMutex; // files open lazily
+    bool _parallelDecode{true};
 };
 } // namespace Wolf3dLoaders
\ No newline at end of file
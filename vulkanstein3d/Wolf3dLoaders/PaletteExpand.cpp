@@ -0,0 +1,120 @@
+#include "PaletteExpand.h"
+#include "Palette.h"
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace Wolf3dLoaders
+{
+static PaletteTable BuildPaletteTable(bool transparent)
+{
+    PaletteTable table{};
+    for (size_t i = 0; i < table.size(); i++)
+        std::memcpy(&table[i], &Palette[i], sizeof(uint32_t));
+
+    if (transparent)
+        table[0xFF] = 0;
+
+    return table;
+}
+
+const PaletteTable& GetPaletteTable(bool transparent)
+{
+    static const PaletteTable opaqueTable = BuildPaletteTable(false);
+    static const PaletteTable transparentTable = BuildPaletteTable(true);
+
+    return transparent ? transparentTable : opaqueTable;
+}
+
+void ExpandPalette(const uint8_t* indices, uint8_t* rgba, size_t count, const PaletteTable& table)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const auto base = reinterpret_cast<const int*>(table.data());
+    for (; i + 8 <= count; i += 8)
+    {
+        const auto index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i)));
+        const auto texels = _mm256_i32gather_epi32(base, index, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + i * 4), texels);
+    }
+#endif
+
+    for (; i < count; i++)
+        std::memcpy(rgba + i * 4, &table[indices[i]], sizeof(uint32_t));
+}
+
+void TransposeIndices64(const uint8_t* source, uint8_t* dest)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    // 8x8 byte blocks, interleaving bytes, words and dwords of eight source columns.
+    for (int by = 0; by < 64; by += 8)
+    {
+        for (int bx = 0; bx < 64; bx += 8)
+        {
+            __m128i r[8];
+            for (int j = 0; j < 8; j++)
+                r[j] = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + (bx + j) * 64 + by));
+
+            const auto a0 = _mm_unpacklo_epi8(r[0], r[1]);
+            const auto a1 = _mm_unpacklo_epi8(r[2], r[3]);
+            const auto a2 = _mm_unpacklo_epi8(r[4], r[5]);
+            const auto a3 = _mm_unpacklo_epi8(r[6], r[7]);
+
+            const auto b0 = _mm_unpacklo_epi16(a0, a1);
+            const auto b1 = _mm_unpackhi_epi16(a0, a1);
+            const auto b2 = _mm_unpacklo_epi16(a2, a3);
+            const auto b3 = _mm_unpackhi_epi16(a2, a3);
+
+            const __m128i c[4] = {_mm_unpacklo_epi32(b0, b2), _mm_unpackhi_epi32(b0, b2), _mm_unpacklo_epi32(b1, b3), _mm_unpackhi_epi32(b1, b3)};
+            for (int j = 0; j < 4; j++)
+            {
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + (by + j * 2) * 64 + bx), c[j]);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + (by + j * 2 + 1) * 64 + bx), _mm_unpackhi_epi64(c[j], c[j]));
+            }
+        }
+    }
+#else
+    for (int y = 0; y < 64; y++)
+    {
+        for (int x = 0; x < 64; x++)
+            dest[y * 64 + x] = source[x * 64 + y];
+    }
+#endif
+}
+
+void UnplanarizeRow(const uint8_t* row, size_t planeSize, int width, uint8_t* dest)
+{
+    const int planeWidth = width >> 2;
+    int k = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; k + 16 <= planeWidth; k += 16)
+    {
+        const auto p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k));
+        const auto p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k + planeSize));
+        const auto p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k + planeSize * 2));
+        const auto p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + k + planeSize * 3));
+
+        const auto lo01 = _mm_unpacklo_epi8(p0, p1);
+        const auto hi01 = _mm_unpackhi_epi8(p0, p1);
+        const auto lo23 = _mm_unpacklo_epi8(p2, p3);
+        const auto hi23 = _mm_unpackhi_epi8(p2, p3);
+
+        auto out = reinterpret_cast<__m128i*>(dest + k * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo01, lo23));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo01, lo23));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi01, hi23));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi01, hi23));
+    }
+#endif
+
+    for (int x = k * 4; x < width; x++)
+        dest[x] = row[(x >> 2) + (x & 3) * planeSize];
+}
+} // namespace Wolf3dLoaders
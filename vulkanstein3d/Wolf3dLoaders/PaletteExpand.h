@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Wolf3dLoaders
+{
+using PaletteTable = std::array<uint32_t, 256>;
+
+// Palette as packed RGBA8, the transparent variant maps index 0xFF to transparent black.
+const PaletteTable& GetPaletteTable(bool transparent);
+
+// Expands palette indices to RGBA8 texels.
+void ExpandPalette(const uint8_t* indices, uint8_t* rgba, size_t count, const PaletteTable& table);
+
+// Column-major 64x64 VSWAP wall chunk to row-major indices.
+void TransposeIndices64(const uint8_t* source, uint8_t* dest);
+
+// Interleaves one row of a four plane VGA picture, row points at the row in the first plane.
+void UnplanarizeRow(const uint8_t* row, size_t planeSize, int width, uint8_t* dest);
+} // namespace Wolf3dLoaders